@@ -0,0 +1,228 @@
+/*
+ * File: arena.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the arena.h interface.
+ */
+
+#include "arena.h"
+#include "genlib.h"
+
+/*
+ * Constants
+ * ---------------------------
+ * BLOCK_ALIGNMENT -- Every block starts on this boundary
+ * CACHE_LINE      -- The first block of a slab starts on this boundary
+ * MIN_SLAB_BLOCKS -- Number of blocks in the first slab
+ * MAX_SLAB_BLOCKS -- Slabs double in size up to this limit
+ */
+#define BLOCK_ALIGNMENT 8
+#define CACHE_LINE 64
+#define MIN_SLAB_BLOCKS 32
+#define MAX_SLAB_BLOCKS 65536
+
+#define ALIGN(n) (((n)+BLOCK_ALIGNMENT-1)/BLOCK_ALIGNMENT*BLOCK_ALIGNMENT)
+
+/*
+ * Type: slabT
+ * ---------------------------
+ * Every slab starts with this header, the blocks follow
+ * from the next cache line boundary. Blocks whose size
+ * divides the cache line therefore never straddle two lines.
+ */
+typedef struct slabT {
+	struct slabT *next;
+} *slabT;
+
+#define SLAB_HEADER (sizeof(struct slabT)+CACHE_LINE-1)
+
+/*
+ * Type: freeBlockT
+ * ---------------------------
+ * A block on the free-list only holds the link.
+ */
+typedef struct freeBlockT {
+	struct freeBlockT *next;
+} *freeBlockT;
+
+struct arenaCDT {
+	size_t blockSize;
+	size_t slabBlocks;
+	size_t bytes;
+	slabT slabs,lastSlab;
+	char *next,*limit;
+	freeBlockT freeList,lastFree;
+	int refs;
+	struct arenaCDT *merged;
+};
+
+/*
+ * lastSlab and lastFree are the ends of the slab list and the
+ * free-list while these are not empty, so that arenaMerge can
+ * splice both in constant time.
+ *
+ * An arena that has been merged into another keeps no slabs,
+ * it forwards to the other through merged and holds one of
+ * its references.
+ */
+
+/* Private Function Prototypes */
+static void newSlab(arenaADT arena);
+static arenaADT findArena(arenaADT arena);
+static char *addSlab(arenaADT arena, size_t blocks);
+
+/******************* Exported entries **********************/
+
+arenaADT newArena(size_t blockSize){
+	arenaADT arena;
+
+	if(blockSize<sizeof(struct freeBlockT))
+		blockSize=sizeof(struct freeBlockT);
+	arena=New(arenaADT);
+	arena->blockSize=ALIGN(blockSize);
+	arena->slabBlocks=MIN_SLAB_BLOCKS;
+	arena->bytes=sizeof(struct arenaCDT);
+	arena->slabs=arena->lastSlab=NULL;
+	arena->next=NULL;
+	arena->limit=NULL;
+	arena->freeList=arena->lastFree=NULL;
+	arena->refs=1;
+	arena->merged=NULL;
+	return (arena);
+}
+
+void freeArena(arenaADT arena){
+	slabT slab,next;
+	arenaADT target;
+
+	while(arena!=NULL && --arena->refs==0){
+		for(slab=arena->slabs;slab!=NULL;slab=next){
+			next=slab->next;
+			FreeBlock(slab);
+		}
+		target=arena->merged;
+		FreeBlock(arena);
+		arena=target;
+	}
+}
+
+arenaADT arenaShare(arenaADT arena){
+	arena=findArena(arena);
+	arena->refs++;
+	return (arena);
+}
+
+void arenaMerge(arenaADT dest, arenaADT src){
+
+	dest=findArena(dest);
+	src=findArena(src);
+	if(dest==src)
+		return;
+	if(dest->blockSize!=src->blockSize)
+		Error("Arenas of different block sizes!");
+	if(src->slabs!=NULL){
+		if(dest->slabs==NULL)
+			dest->lastSlab=src->lastSlab;
+		src->lastSlab->next=dest->slabs;
+		dest->slabs=src->slabs;
+	}
+	if(src->freeList!=NULL){
+		if(dest->freeList==NULL)
+			dest->lastFree=src->lastFree;
+		src->lastFree->next=dest->freeList;
+		dest->freeList=src->freeList;
+	}
+	if(src->limit-src->next > dest->limit-dest->next){
+		dest->next=src->next;
+		dest->limit=src->limit;
+	}
+	if(src->slabBlocks>dest->slabBlocks)
+		dest->slabBlocks=src->slabBlocks;
+	dest->bytes+=src->bytes;
+	dest->refs++;
+	src->slabs=src->lastSlab=NULL;
+	src->freeList=src->lastFree=NULL;
+	src->next=src->limit=NULL;
+	src->bytes=sizeof(struct arenaCDT);
+	src->merged=dest;
+}
+
+void *arenaAlloc(arenaADT arena){
+	void *block;
+
+	arena=findArena(arena);
+	if(arena->freeList!=NULL){
+		block=arena->freeList;
+		arena->freeList=arena->freeList->next;
+		return (block);
+	}
+	if(arena->next==arena->limit)
+		newSlab(arena);
+	block=arena->next;
+	arena->next+=arena->blockSize;
+	return (block);
+}
+
+void arenaFree(arenaADT arena, void *ptr){
+	freeBlockT block=ptr;
+
+	arena=findArena(arena);
+	if(arena->freeList==NULL)
+		arena->lastFree=block;
+	block->next=arena->freeList;
+	arena->freeList=block;
+}
+
+void *arenaAllocArray(arenaADT arena, size_t count){
+	arena=findArena(arena);
+	if(count>(((size_t)-1)-SLAB_HEADER)/arena->blockSize)
+		Error("No memory available");
+	return (addSlab(arena,count));
+}
+
+size_t arenaBytes(arenaADT arena){
+	return (findArena(arena)->bytes);
+}
+
+/**************** End of exported entries *******************/
+
+static void newSlab(arenaADT arena){
+	arena->next=addSlab(arena,arena->slabBlocks);
+	arena->limit=arena->next+arena->slabBlocks*arena->blockSize;
+	if(arena->slabBlocks<MAX_SLAB_BLOCKS)
+		arena->slabBlocks*=2;
+}
+
+/*
+ * Function: findArena
+ * ---------------------------
+ * Follows the merged links to the arena that owns the slabs.
+ */
+static arenaADT findArena(arenaADT arena){
+	while(arena->merged!=NULL)
+		arena=arena->merged;
+	return (arena);
+}
+
+/*
+ * Function: addSlab
+ * ---------------------------
+ * Links a new slab with room for the given number of blocks
+ * into the arena and returns its first block.
+ */
+static char *addSlab(arenaADT arena, size_t blocks){
+	slabT slab;
+	size_t nbytes;
+	char *first;
+
+	nbytes=SLAB_HEADER+blocks*arena->blockSize;
+	slab=GetBlock(nbytes);
+	if(arena->slabs==NULL)
+		arena->lastSlab=slab;
+	slab->next=arena->slabs;
+	arena->slabs=slab;
+	arena->bytes+=nbytes;
+	first=(char *)slab+SLAB_HEADER;
+	first-=(size_t)first%CACHE_LINE;
+	return (first);
+}
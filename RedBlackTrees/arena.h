@@ -0,0 +1,118 @@
+/*
+ * File: arena.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports a slab allocator for blocks of one
+ * fixed size. Blocks are carved out of large slabs and
+ * freed blocks are kept on a free-list for reuse, so
+ * allocating and freeing a block never calls malloc.
+ * All memory is returned at once by freeArena.
+ *
+ * An arena can be shared by several owners and the blocks
+ * of one arena can be merged into another. An arena is not
+ * safe to use from two threads at the same time.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <stdlib.h>
+#include "genlib.h"
+
+/*
+ * Type: arenaADT
+ * --------------------------
+ * The type arenaADT points to the arena's concrete type.
+ */
+
+typedef struct arenaCDT *arenaADT;
+
+/*
+ * Function: newArena
+ * Usage: arena = newArena(sizeof(struct nodeT));
+ * --------------------------
+ * This function allocates and returns an empty arena
+ * handing out blocks of blockSize bytes.
+ */
+
+arenaADT newArena(size_t blockSize);
+
+/*
+ * Function: freeArena
+ * Usage: freeArena(arena);
+ * -------------------------------
+ * This procedure drops one reference to the arena. When the
+ * last one is gone it frees every slab, including all blocks
+ * still in use. It runs in O(number of slabs).
+ */
+
+void freeArena(arenaADT arena);
+
+/*
+ * Function: arenaShare
+ * Usage: other->arena = arenaShare(tree->arena);
+ * -------------------------------
+ * This function adds a reference to the arena and returns
+ * it. Each reference is given back with freeArena.
+ */
+
+arenaADT arenaShare(arenaADT arena);
+
+/*
+ * Function: arenaMerge
+ * Usage: arenaMerge(dest, src);
+ * -------------------------------
+ * This procedure moves all slabs and free blocks of src
+ * into dest, so blocks allocated from either can be freed
+ * to either. Both arenas stay valid and now name the same
+ * storage, which lives until every reference to either of
+ * them is freed. The arenas must have the same block size.
+ * It runs in constant time.
+ */
+
+void arenaMerge(arenaADT dest, arenaADT src);
+
+/*
+ * Function: arenaAlloc
+ * Usage: ptr = arenaAlloc(arena);
+ * -------------------------------
+ * This function returns an uninitialized block. Recently
+ * freed blocks are reused first.
+ */
+
+void *arenaAlloc(arenaADT arena);
+
+/*
+ * Function: arenaFree
+ * Usage: arenaFree(arena, ptr);
+ * -------------------------------
+ * This procedure gives a block back to the arena it was
+ * allocated from. The first word of the block is used as
+ * the free-list link.
+ */
+
+void arenaFree(arenaADT arena, void *ptr);
+
+/*
+ * Function: arenaAllocArray
+ * Usage: nodes = arenaAllocArray(arena, n);
+ * -------------------------------
+ * This function returns count uninitialized blocks that
+ * follow each other in memory, blockSize bytes apart. They
+ * get a slab of their own and each of them can later be
+ * given back with arenaFree.
+ */
+
+void *arenaAllocArray(arenaADT arena, size_t count);
+
+/*
+ * Function: arenaBytes
+ * Usage: bytes = arenaBytes(arena);
+ * -------------------------------
+ * This function returns the number of bytes the arena has
+ * taken from the system, bookkeeping included.
+ */
+
+size_t arenaBytes(arenaADT arena);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * File: epoch.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the epoch.h interface.
+ */
+
+#include "epoch.h"
+#include "genlib.h"
+
+/*
+ * Constants
+ * ---------------------------
+ * CACHE_LINE      -- Slots are padded to keep their epochs
+ *                    on lines of their own
+ * INITIAL_SLOTS   -- Slots the registration array starts with
+ */
+#define CACHE_LINE 64
+#define INITIAL_SLOTS 8
+
+/*
+ * epoch is 0 while the thread is outside and else the epoch
+ * it came in during.
+ */
+struct epochSlotCDT {
+	volatile int32_t epoch;
+	epochADT epochs;
+	char padding[CACHE_LINE];
+};
+
+/*
+ * The slots are only added, removed and read under lock.
+ */
+struct epochCDT {
+	volatile int32_t epoch;
+	mutexADT lock;
+	epochSlotADT *slots;
+	int slotCount,slotCapacity;
+};
+
+/******************* Exported entries **********************/
+
+epochADT newEpoch(void){
+	epochADT epochs;
+
+	epochs=New(epochADT);
+	epochs->epoch=1;
+	epochs->lock=newMutex();
+	epochs->slots=NULL;
+	epochs->slotCount=epochs->slotCapacity=0;
+	return (epochs);
+}
+
+void freeEpoch(epochADT epochs){
+
+	if(epochs==NULL)
+		Error("Epochs not initialized!");
+	if(epochs->slotCount>0)
+		Error("The epochs still have slots!");
+	if(epochs->slots!=NULL)
+		free(epochs->slots);
+	freeMutex(epochs->lock);
+	FreeBlock(epochs);
+}
+
+epochSlotADT newEpochSlot(epochADT epochs){
+	epochSlotADT slot;
+
+	if(epochs==NULL)
+		Error("Epochs not initialized!");
+	slot=New(epochSlotADT);
+	slot->epoch=0;
+	slot->epochs=epochs;
+	lockMutex(epochs->lock);
+	if(epochs->slotCount==epochs->slotCapacity){
+		epochs->slotCapacity=(epochs->slotCapacity==0) ? INITIAL_SLOTS : 2*epochs->slotCapacity;
+		epochs->slots=realloc(epochs->slots,epochs->slotCapacity*sizeof(epochSlotADT));
+		if(epochs->slots==NULL)
+			Error("No memory available");
+	}
+	epochs->slots[epochs->slotCount++]=slot;
+	unlockMutex(epochs->lock);
+	return (slot);
+}
+
+void freeEpochSlot(epochSlotADT slot){
+	epochADT epochs;
+	int i;
+
+	if(slot==NULL)
+		Error("Slot not initialized!");
+	epochs=slot->epochs;
+	lockMutex(epochs->lock);
+	for(i=0;epochs->slots[i]!=slot;i++)
+		;
+	epochs->slots[i]=epochs->slots[--epochs->slotCount];
+	unlockMutex(epochs->lock);
+	FreeBlock(slot);
+}
+
+/*
+ * Implementation notes: enterEpoch, leaveEpoch
+ * ---------------------------
+ * The epoch must be visible to other threads before the thread
+ * reads the structure, which takes the full fence, and the
+ * thread must be done with it before it clears its epoch.
+ */
+void enterEpoch(epochSlotADT slot){
+	slot->epoch=slot->epochs->epoch;
+	memoryFence();
+}
+
+void leaveEpoch(epochSlotADT slot){
+	releaseFence();
+	slot->epoch=0;
+}
+
+int32_t currentEpoch(epochADT epochs){
+	return (epochs->epoch);
+}
+
+int32_t oldestEpoch(epochADT epochs){
+	int32_t epoch,oldest;
+	int i;
+
+	lockMutex(epochs->lock);
+	oldest=epochs->epoch;
+	for(i=0;i<epochs->slotCount;i++){
+		epoch=epochs->slots[i]->epoch;
+		if(epoch!=0 && epoch<oldest)
+			oldest=epoch;
+	}
+	unlockMutex(epochs->lock);
+	return (oldest);
+}
+
+int32_t advanceEpoch(epochADT epochs){
+	return (atomicAdd(&epochs->epoch,1));
+}
+
+/*
+ * Implementation notes: tryAdvanceEpoch
+ * ---------------------------
+ * A thread that comes in after the slots were read came in
+ * during the current epoch, so it is at most one behind once
+ * the new epoch starts. The swap fails if another thread has
+ * started it first.
+ */
+bool tryAdvanceEpoch(epochADT epochs){
+	int32_t current;
+
+	current=epochs->epoch;
+	if(oldestEpoch(epochs)!=current)
+		return (FALSE);
+	return (atomicCompareSwap(&epochs->epoch,current,current+1));
+}
+
+/**************** End of exported entries *******************/
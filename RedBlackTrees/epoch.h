@@ -0,0 +1,108 @@
+/*
+ * File: epoch.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports the epochs that sharedtree.c and
+ * skiplist.c use to know when no thread can still be reading
+ * a node they have unlinked.
+ *
+ * Each thread that reads the structure has a slot of its own.
+ * It enters the current epoch before it reads and leaves it
+ * when it is done. A node unlinked in some epoch can be freed
+ * once no thread is inside that epoch or an earlier one, since
+ * a thread that came in later can't reach it.
+ */
+
+#ifndef _epoch_h
+#define _epoch_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "platform.h"
+
+/*
+ * Types: epochADT, epochSlotADT
+ * --------------------------
+ * The type epochADT points to the epoch counter and the slots
+ * registered with it, and epochSlotADT to the slot of one
+ * thread.
+ */
+
+typedef struct epochCDT *epochADT;
+typedef struct epochSlotCDT *epochSlotADT;
+
+/*
+ * Function: newEpoch
+ * Usage: epochs = newEpoch();
+ * --------------------------
+ * This function allocates and returns an epoch counter with
+ * no slots. The first epoch is 1.
+ */
+
+epochADT newEpoch(void);
+
+/*
+ * Function: freeEpoch
+ * Usage: freeEpoch(epochs);
+ * -------------------------------
+ * This procedure frees the epoch counter. Its slots must be
+ * freed first.
+ */
+
+void freeEpoch(epochADT epochs);
+
+/*
+ * Functions: newEpochSlot, freeEpochSlot
+ * Usage: slot = newEpochSlot(epochs); freeEpochSlot(slot);
+ * -------------------------------
+ * These register a thread with the epochs and unregister it
+ * again. A slot is used by one thread at a time.
+ */
+
+epochSlotADT newEpochSlot(epochADT epochs);
+void freeEpochSlot(epochSlotADT slot);
+
+/*
+ * Functions: enterEpoch, leaveEpoch
+ * Usage: enterEpoch(slot); ... leaveEpoch(slot);
+ * -------------------------------
+ * These bracket the reads of one operation. Calls don't nest.
+ */
+
+void enterEpoch(epochSlotADT slot);
+void leaveEpoch(epochSlotADT slot);
+
+/*
+ * Function: currentEpoch
+ * Usage: epoch = currentEpoch(epochs);
+ * -------------------------------
+ * This function returns the current epoch.
+ */
+
+int32_t currentEpoch(epochADT epochs);
+
+/*
+ * Function: oldestEpoch
+ * Usage: if(oldestEpoch(epochs) >= epoch) ...
+ * -------------------------------
+ * This function returns the earliest epoch any thread is
+ * inside, or the current epoch if none is. It runs in
+ * O(number of slots).
+ */
+
+int32_t oldestEpoch(epochADT epochs);
+
+/*
+ * Functions: advanceEpoch, tryAdvanceEpoch
+ * Usage: epoch = advanceEpoch(epochs); if(tryAdvanceEpoch(epochs)) ...
+ * -------------------------------
+ * advanceEpoch starts a new epoch and returns it.
+ * tryAdvanceEpoch only starts one if every thread inside came
+ * in during the current epoch, and returns TRUE if it did, so
+ * no thread is ever more than one epoch behind.
+ */
+
+int32_t advanceEpoch(epochADT epochs);
+bool tryAdvanceEpoch(epochADT epochs);
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ * File: frozen.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the frozen.h interface.
+ */
+
+#include <limits.h>
+#include "frozen.h"
+#include "genlib.h"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define FROZEN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#  include <emmintrin.h>
+#  define FROZEN_SSE2
+#endif
+
+/*
+ * Constants
+ * ---------------------------
+ * BLOCK      -- Keys per block, one cache line of ints
+ * CACHE_LINE -- Every block starts on this boundary
+ * MAX_LAYERS -- More layers than any size_t number of values needs
+ * PADDING    -- Fills the unused keys, it is never less than a value
+ */
+#define BLOCK 16
+#define CACHE_LINE 64
+#define MAX_LAYERS 16
+#define PADDING INT_MAX
+
+/*
+ * The blocks of layer h start at keys+offsets[h], layer 0
+ * holds the values in order. Block b of layer h>0 has BLOCK+1
+ * children, blocks b*(BLOCK+1)..b*(BLOCK+1)+BLOCK of layer h-1,
+ * and its key j is the smallest value below child j+1. Keys
+ * of missing children are PADDING. offsets[height] is the
+ * total number of keys.
+ */
+struct frozenCDT {
+	elementT *keys;
+	void *storage;
+	size_t size;
+	int height;
+	size_t offsets[MAX_LAYERS+1];
+};
+
+/* Private Function Prototypes */
+static size_t layerBlocks(size_t n);
+static size_t lowerIndex(frozenADT frozen, elementT value);
+static size_t blockRank(const elementT *block, elementT value);
+#if defined(FROZEN_AVX2) || defined(FROZEN_SSE2)
+static int countBits(unsigned mask);
+#endif
+
+/******************* Exported entries **********************/
+
+/*
+ * Implementation notes: treeFreeze
+ * ---------------------------
+ * The values are copied into layer 0 in order. A key of an
+ * upper layer is found by following child j+1 and then the
+ * first child down to layer 0.
+ */
+frozenADT treeFreeze(treeADT tree){
+	frozenADT frozen;
+	cursorT cursor;
+	size_t n,i,b,j,child;
+	int h,l;
+
+	frozen=New(frozenADT);
+	frozen->size=treeSize(tree);
+	frozen->height=0;
+	n=frozen->size;
+	frozen->offsets[0]=0;
+	do {
+		frozen->offsets[frozen->height+1]=frozen->offsets[frozen->height]+layerBlocks(n)*BLOCK;
+		frozen->height++;
+		n=(layerBlocks(n)+BLOCK)/(BLOCK+1)*BLOCK;
+	} while(frozen->offsets[frozen->height]-frozen->offsets[frozen->height-1]>BLOCK);
+	n=frozen->offsets[frozen->height];
+	frozen->storage=GetBlock(n*sizeof(elementT)+CACHE_LINE);
+	frozen->keys=(elementT *)((char *)frozen->storage+CACHE_LINE-(size_t)frozen->storage%CACHE_LINE);
+	i=0;
+	for(cursor=treeFirst(tree);cursorValid(cursor);cursorNext(&cursor))
+		frozen->keys[i++]=cursorKey(cursor);
+	for(;i<frozen->offsets[1];i++)
+		frozen->keys[i]=PADDING;
+	for(h=1;h<frozen->height;h++){
+		for(i=0;i<frozen->offsets[h+1]-frozen->offsets[h];i++){
+			b=i/BLOCK;
+			j=i%BLOCK;
+			child=b*(BLOCK+1)+j+1;
+			for(l=1;l<h;l++)
+				child*=BLOCK+1;
+			frozen->keys[frozen->offsets[h]+i]=(child*BLOCK<frozen->size) ?
+				frozen->keys[child*BLOCK] : PADDING;
+		}
+	}
+	return (frozen);
+}
+
+void freeFrozen(frozenADT frozen){
+
+	if(frozen==NULL)
+		Error("Snapshot not initialized!");
+	FreeBlock(frozen->storage);
+	FreeBlock(frozen);
+}
+
+size_t frozenSize(frozenADT frozen){
+	return (frozen->size);
+}
+
+elementT frozenFind(frozenADT frozen, elementT value){
+	size_t i;
+
+	i=lowerIndex(frozen,value);
+	if(i<frozen->size && !(value < frozen->keys[i]))
+		return (frozen->keys[i]);
+	return (NOT_FOUND);
+}
+
+size_t frozenLowerBound(frozenADT frozen, elementT value){
+	return (lowerIndex(frozen,value));
+}
+
+elementT frozenValue(frozenADT frozen, size_t i){
+
+	if(i>=frozen->size)
+		Error("Rank out of range!");
+	return (frozen->keys[i]);
+}
+
+void frozenRangeScan(frozenADT frozen, elementT lo, elementT hi,
+                     scanFnT fn, void *clientData){
+	size_t i;
+
+	for(i=lowerIndex(frozen,lo);i<frozen->size && frozen->keys[i] < hi;i++)
+		fn(frozen->keys[i],clientData);
+}
+
+size_t frozenRangeCount(frozenADT frozen, elementT lo, elementT hi){
+	size_t first,last;
+
+	if(!(lo < hi))
+		return (0);
+	first=lowerIndex(frozen,lo);
+	last=lowerIndex(frozen,hi);
+	return (last-first);
+}
+
+size_t frozenMemoryUsage(frozenADT frozen){
+	return (sizeof(struct frozenCDT)+frozen->offsets[frozen->height]*sizeof(elementT)+CACHE_LINE);
+}
+
+/**************** End of exported entries *******************/
+
+/*
+ * Function: layerBlocks
+ * ---------------------------
+ * Returns the number of blocks needed for n keys.
+ */
+static size_t layerBlocks(size_t n){
+	return ((n+BLOCK-1)/BLOCK);
+}
+
+/*
+ * Function: lowerIndex
+ * ---------------------------
+ * Returns the position in layer 0 of the first value not less
+ * than value. k is the first key of the current block, and the
+ * rank of value within it picks the child to go on with. In
+ * layer 0 the rank may be BLOCK, which is the first value of
+ * the next block.
+ */
+static size_t lowerIndex(frozenADT frozen, elementT value){
+	size_t k=0;
+	int h;
+
+	if(frozen->size==0)
+		return (0);
+	for(h=frozen->height-1;h>0;h--)
+		k=k*(BLOCK+1)+blockRank(frozen->keys+frozen->offsets[h]+k,value)*BLOCK;
+	k+=blockRank(frozen->keys+k,value);
+	return (k<frozen->size ? k : frozen->size);
+}
+
+/*
+ * Function: blockRank
+ * ---------------------------
+ * Returns the number of keys in the block that are less than
+ * value. All keys are compared at once and the results are
+ * gathered in a bit mask, so there is no branch that depends
+ * on the keys.
+ */
+static size_t blockRank(const elementT *block, elementT value){
+#if defined(FROZEN_AVX2)
+	__m256i x=_mm256_set1_epi32(value);
+	__m256i lo=_mm256_cmpgt_epi32(x,_mm256_load_si256((const __m256i *)block));
+	__m256i hi=_mm256_cmpgt_epi32(x,_mm256_load_si256((const __m256i *)(block+8)));
+
+	return (countBits((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lo)) |
+	                  (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hi))<<8));
+#elif defined(FROZEN_SSE2)
+	__m128i x=_mm_set1_epi32(value);
+	__m128i a=_mm_cmpgt_epi32(x,_mm_load_si128((const __m128i *)block));
+	__m128i b=_mm_cmpgt_epi32(x,_mm_load_si128((const __m128i *)(block+4)));
+	__m128i c=_mm_cmpgt_epi32(x,_mm_load_si128((const __m128i *)(block+8)));
+	__m128i d=_mm_cmpgt_epi32(x,_mm_load_si128((const __m128i *)(block+12)));
+
+	return (countBits((unsigned)_mm_movemask_epi8(
+		_mm_packs_epi16(_mm_packs_epi32(a,b),_mm_packs_epi32(c,d)))));
+#else
+	size_t i,rank=0;
+
+	for(i=0;i<BLOCK;i++)
+		rank+=(block[i] < value);
+	return (rank);
+#endif
+}
+
+#if defined(FROZEN_AVX2) || defined(FROZEN_SSE2)
+static int countBits(unsigned mask){
+#if defined(__GNUC__)
+	return (__builtin_popcount(mask));
+#else
+	mask=mask-((mask>>1)&0x55555555u);
+	mask=(mask&0x33333333u)+((mask>>2)&0x33333333u);
+	mask=(mask+(mask>>4))&0x0f0f0f0fu;
+	return ((int)((mask*0x01010101u)>>24));
+#endif
+}
+#endif
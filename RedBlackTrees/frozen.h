@@ -0,0 +1,126 @@
+/*
+ * File: frozen.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports read-only snapshots of red-black trees.
+ * A snapshot keeps the values in a static B+ tree of 16-key
+ * blocks, one cache line each, with the sorted values as its
+ * bottom layer. A search reads one block per level and ranks
+ * the value within a block with SIMD compares, using AVX2 or
+ * SSE2 when the compiler targets them. A million values take
+ * five levels where the live tree descends about twenty nodes,
+ * and a snapshot takes little more than 4 bytes per value.
+ *
+ * The searches assume that elementT is a 32-bit int.
+ */
+
+#ifndef _frozen_h
+#define _frozen_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Type: frozenADT
+ * --------------------------
+ * The type frozenADT points to the snapshot's concrete type.
+ */
+
+typedef struct frozenCDT *frozenADT;
+
+/*
+ * Function: treeFreeze
+ * Usage: frozen = treeFreeze(tree);
+ * --------------------------
+ * This function returns a snapshot of the values currently in
+ * the tree. The snapshot never changes and doesn't depend on
+ * the tree, which can be changed or freed afterwards. It is
+ * built in O(n). A snapshot may be searched by any number of
+ * threads at the same time.
+ */
+
+frozenADT treeFreeze(treeADT tree);
+
+/*
+ * Function: freeFrozen
+ * Usage: freeFrozen(frozen);
+ * -------------------------------
+ * This procedure frees the storage associated with the snapshot.
+ */
+
+void freeFrozen(frozenADT frozen);
+
+/*
+ * Function: frozenSize
+ * Usage: n=frozenSize(frozen);
+ * -------------------------------
+ * This function returns the number of values in the snapshot.
+ */
+
+size_t frozenSize(frozenADT frozen);
+
+/*
+ * Function: frozenFind
+ * Usage: value=frozenFind(frozen, value);
+ * -------------------------------
+ * This function is used to find a value in the snapshot.
+ * If the value doesn't exist the function returns the
+ * constant NOT_FOUND.
+ */
+
+elementT frozenFind(frozenADT frozen, elementT value);
+
+/*
+ * Function: frozenLowerBound
+ * Usage: i=frozenLowerBound(frozen, value);
+ * -------------------------------
+ * This function returns the position, counted from 0 in
+ * increasing order, of the first value >= value, or
+ * frozenSize if there is none.
+ */
+
+size_t frozenLowerBound(frozenADT frozen, elementT value);
+
+/*
+ * Function: frozenValue
+ * Usage: value=frozenValue(frozen, i);
+ * -------------------------------
+ * This function returns the value at position i, so the
+ * values from a lower bound on can be read in order.
+ */
+
+elementT frozenValue(frozenADT frozen, size_t i);
+
+/*
+ * Function: frozenRangeScan
+ * Usage: frozenRangeScan(frozen, lo, hi, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * v with lo <= v < hi, in increasing order, like treeRangeScan.
+ * It runs in O(log n + k) for k values.
+ */
+
+void frozenRangeScan(frozenADT frozen, elementT lo, elementT hi,
+                     scanFnT fn, void *clientData);
+
+/*
+ * Function: frozenRangeCount
+ * Usage: n=frozenRangeCount(frozen, lo, hi);
+ * -------------------------------
+ * This function returns the number of values v with
+ * lo <= v < hi in O(log n).
+ */
+
+size_t frozenRangeCount(frozenADT frozen, elementT lo, elementT hi);
+
+/*
+ * Function: frozenMemoryUsage
+ * Usage: bytes=frozenMemoryUsage(frozen);
+ * -------------------------------
+ * This function returns the number of bytes held by the snapshot.
+ */
+
+size_t frozenMemoryUsage(frozenADT frozen);
+
+#endif
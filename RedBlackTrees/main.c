@@ -11,13 +11,225 @@
 #include "simpio.h"
 #include "random.h"
 #include "redblack.h"
+#include "topdown.h"
+#include "frozen.h"
+#include "persist.h"
+#include "sharedtree.h"
+#include "sharded.h"
+#include "skiplist.h"
 #include "strlib.h"
+#include "platform.h"
+
+/* Constants */
+
+#define MAX_THREADS 64
+#define SHARED_OPERATIONS 200000
+#define CONTENDED_OPERATIONS 100000
+#define LATENCY_SAMPLE 16
+#define OWNED_KEYS 256
+
+/*
+ * Type: churnT
+ * -------------
+ * The work given to one thread in the thread scaling test.
+ */
+
+typedef struct {
+	int size;
+	unsigned seed;
+} churnT;
+
+/*
+ * Type: mvccT
+ * -------------
+ * The work given to one reader or writer thread in the
+ * persistent tree test, and what it got done.
+ */
+
+typedef struct {
+	liveTreeADT live;
+	unsigned seed;
+	double deadline;
+	double operations;
+} mvccT;
+
+/*
+ * Type: readMostlyT
+ * -------------
+ * The work given to one thread in the shared tree test: 95%
+ * lookups and 5% writes, either in a tree behind a mutex or
+ * in a shared tree.
+ */
+
+typedef struct {
+	sharedTreeADT shared;
+	treeADT tree;
+	mutexADT lock;
+	unsigned seed;
+	size_t retries;
+} readMostlyT;
+
+/*
+ * Type: ingestT
+ * -------------
+ * The work given to one thread in the sharded tree test: count
+ * random values below range to insert, either into a tree
+ * behind a mutex or into a sharded tree.
+ */
+
+typedef struct {
+	shardedADT sharded;
+	treeADT tree;
+	mutexADT lock;
+	unsigned seed;
+	int count,range;
+} ingestT;
+
+/*
+ * Type: contendT
+ * -------------
+ * The work given to one thread in the lock-free set test:
+ * inserts, deletes, lookups and delete-mins on a small key
+ * range, either in a tree behind a mutex or in a skip list.
+ * Every LATENCY_SAMPLE-th operation is timed.
+ */
+
+typedef struct {
+	skipListADT list;
+	treeADT tree;
+	mutexADT lock;
+	unsigned seed;
+	int range;
+	double *latencies;
+} contendT;
+
+/*
+ * Type: ownedT
+ * -------------
+ * The work given to one thread in the lock-free set check.
+ * owned[j] tells if the thread's j-th key is in the list, net
+ * counts its inserts minus its deletes of shared keys, and
+ * wrong the operations on its own keys that gave the wrong
+ * answer.
+ */
+
+typedef struct {
+	skipListADT list;
+	unsigned seed;
+	int id,threads,range;
+	bool *owned;
+	long net;
+	int wrong;
+} ownedT;
+
+/*
+ * Type: orderCheckT
+ * -------------
+ * What the sharded tree test's scan callback has seen so far.
+ */
+
+typedef struct {
+	elementT last;
+	size_t seen;
+	bool ordered;
+} orderCheckT;
+
+/*
+ * Type: versionT
+ * -------------
+ * A struct key for the generic tree test.
+ */
+
+typedef struct {
+	int major,minor;
+} versionT;
+
+/* Tree types for the generic tree test */
+
+#define RBT_PREFIX intSet
+#define RBT_KEY int
+#include "rbtemplate.h"
+
+#define RBT_PREFIX longMap
+#define RBT_KEY int64_t
+#define RBT_VALUE int
+#include "rbtemplate.h"
+
+#define RBT_PREFIX realMap
+#define RBT_KEY double
+#define RBT_VALUE int
+#include "rbtemplate.h"
+
+#define RBT_PREFIX versionMap
+#define RBT_KEY versionT
+#define RBT_VALUE int
+#define RBT_COMPARE(a,b) ((a).major!=(b).major ? ((a).major<(b).major ? -1 : 1) \
+                                               : ((a).minor<(b).minor ? -1 : (a).minor>(b).minor))
+#include "rbtemplate.h"
 
 /* Function Prototypes */
 void printMenu(void);
 void heightTest(void);
 void structureTest(void);
 void buildTree(void);
+void threadTest(void);
+void memoryTest(void);
+void genericTest(void);
+void orderTest(void);
+void scanTest(void);
+void rangeTest(void);
+void countValue(elementT value, void *clientData);
+void bulkLoadTest(void);
+double timeScan(treeADT tree);
+void setTest(void);
+void fillSorted(elementT values[], int n);
+void hintTest(void);
+void timeHints(string name, elementT values[], int n);
+void handleTest(void);
+void engineTest(void);
+void descentTest(void);
+void batchTest(void);
+void sortedBatchTest(void);
+void timeSortedBatch(treeADT tree, elementT queries[], elementT results[],
+                     int n, int range);
+void frozenTest(void);
+void compactTest(void);
+void churnKeys(treeADT tree, elementT keys[], int n, int rounds);
+double timeLookups(treeADT tree, elementT keys[], int n);
+void persistTest(void);
+void timeVersions(versionADT version, elementT keys[], int n);
+double runReaders(liveTreeADT live, int readers, bool writer, double *updates);
+void readSnapshots(void *arg);
+void writeVersions(void *arg);
+void sharedTest(void);
+double runReadMostly(sharedTreeADT shared, treeADT tree, mutexADT lock,
+                     int n, size_t *retries);
+void lockedReadMostly(void *arg);
+void sharedReadMostly(void *arg);
+void shardedTest(void);
+double runIngest(shardedADT sharded, treeADT tree, mutexADT lock,
+                 int n, int size, int range);
+void ingestValues(void *arg);
+void checkOrder(elementT value, void *clientData);
+void lockFreeTest(void);
+double runContended(skipListADT list, treeADT tree, mutexADT lock,
+                    int n, int range, double *latencies);
+void contendLocked(void *arg);
+void contendLockFree(void *arg);
+void checkLockFree(int n, int range);
+void churnOwned(void *arg);
+int compareLatencies(const void *a, const void *b);
+void relaxedTest(void);
+double timeBurst(treeADT tree, elementT keys[], int n, double *latencies);
+void timeRedBlack(int *keys, int n);
+void timeIntSet(int *keys, int n);
+void timeLongMap(int *keys, int n);
+void timeRealMap(int *keys, int n);
+void timeVersionMap(int *keys, int n);
+void timeUpsert(int *keys, int n);
+void printTimes(string name, double times[], int n);
+void churnTree(void *arg);
+int nextRandom(unsigned *seed);
 treeADT buildTestTreeOrdered(int size);
 treeADT buildTestTreeReversed(int size);
 treeADT buildTestTreeRandom(int size);
@@ -35,6 +247,27 @@ main(){
 			case 1: heightTest();break;
 			case 2: structureTest();break;
 			case 3: buildTree();break;
+			case 4: threadTest();break;
+			case 5: memoryTest();break;
+			case 6: genericTest();break;
+			case 7: orderTest();break;
+			case 8: scanTest();break;
+			case 9: rangeTest();break;
+			case 10: bulkLoadTest();break;
+			case 11: setTest();break;
+			case 12: hintTest();break;
+			case 13: handleTest();break;
+			case 14: engineTest();break;
+			case 15: descentTest();break;
+			case 16: batchTest();break;
+			case 17: sortedBatchTest();break;
+			case 18: frozenTest();break;
+			case 19: compactTest();break;
+			case 20: persistTest();break;
+			case 21: sharedTest();break;
+			case 22: shardedTest();break;
+			case 23: lockFreeTest();break;
+			case 24: relaxedTest();break;
 			case 0: exit(0);
 			default: printf("Invalid choice. Try again.");
 		}
@@ -48,6 +281,27 @@ void printMenu(void){
 	printf("1. Height Test\n");
 	printf("2. Structure Test\n");
 	printf("3. Build your own tree!\n");
+	printf("4. Thread Scaling Test\n");
+	printf("5. Memory Test\n");
+	printf("6. Generic Tree Test\n");
+	printf("7. Order Statistics Test\n");
+	printf("8. Scan Test\n");
+	printf("9. Range Query Test\n");
+	printf("10. Bulk Load Test\n");
+	printf("11. Set Operations Test\n");
+	printf("12. Hinted Insert Test\n");
+	printf("13. Handle Test\n");
+	printf("14. Top-Down Engine Test\n");
+	printf("15. Descent Test\n");
+	printf("16. Batch Lookup Test\n");
+	printf("17. Sorted Batch Test\n");
+	printf("18. Frozen Snapshot Test\n");
+	printf("19. Compaction Test\n");
+	printf("20. Persistent Tree Test\n");
+	printf("21. Shared Tree Test\n");
+	printf("22. Sharded Tree Test\n");
+	printf("23. Lock-Free Set Test\n");
+	printf("24. Relaxed Balance Test\n");
 	printf("0. Quit\n");
 	printf("Your choice: ");
 }
@@ -131,7 +385,7 @@ void structureTest(void){
 	printf("\n\n");
 	printf("--------------------------------------------\n");
 	printf("\n");
-	freeTree(treeOrd);
+	freeTree(treeRev);
 
 	treeRan=buildTestTreeRandom(TEST_SIZE);
 	printf("Random input || Tree size: %d\n\n",TEST_SIZE);
@@ -150,7 +404,7 @@ void structureTest(void){
 void buildTree(void){
 	treeADT tree=newTree();
 	string userOP;
-	int userInt,element;
+	int userInt;
 
 	printf("\n**** Tree builder ****\n\n");
 	while(TRUE){
@@ -180,8 +434,7 @@ void buildTree(void){
 		if(StringEqual(userOP,"f")){
 			printf("FindNode: ");
 			userInt=GetInteger();
-			element=findNode(tree,userInt);
-			if(element!=NOT_FOUND)
+			if(treeFindPtr(tree,userInt)!=NULL)
 				printf("\nFound %d in your tree! :-)\n",userInt);
 			else
 				printf("\nDid not find %d in your tree. :-(\n",userInt);
@@ -205,6 +458,1912 @@ void buildTree(void){
 	freeTree(tree);
 }
 
+void threadTest(void){
+	threadADT threads[MAX_THREADS];
+	churnT work[MAX_THREADS];
+	int i,n,TEST_SIZE,NUM_OF_THREADS;
+	double start,elapsed,base=0;
+
+	system("cls");
+	printf("Thread Scaling Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+	printf("Enter max number of threads (max: %d): ",MAX_THREADS);
+	NUM_OF_THREADS=GetInteger();
+	printf("\n");
+	if(NUM_OF_THREADS<=0 || NUM_OF_THREADS>MAX_THREADS)
+		Error("I refuse!");
+
+	printf("One tree per thread || Tree size: %d || Operations per thread: %d\n",TEST_SIZE,4*TEST_SIZE);
+	for(n=1;n<=NUM_OF_THREADS;n++){
+		start=wallClock();
+		for(i=0;i<n;i++){
+			work[i].size=TEST_SIZE;
+			work[i].seed=i+1;
+			threads[i]=newThread(churnTree,&work[i]);
+		}
+		for(i=0;i<n;i++)
+			joinThread(threads[i]);
+		elapsed=wallClock()-start;
+		if(n==1)
+			base=elapsed;
+		printf("Threads: %2d || Time: %.3f s || Operations/s: %.0f || Speedup: %.2f\n",
+			n,elapsed,4.0*TEST_SIZE*n/elapsed,base*n/elapsed);
+	}
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+void memoryTest(void){
+	treeADT tree;
+	int i,TEST_SIZE,*keys;
+	size_t bytes;
+	double start,elapsed;
+
+	system("cls");
+	printf("Tree Memory Tester\n\n");
+	printf("Enter tree size (rec.: 10000000): ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	printf("Random input || Tree size: %d\n",TEST_SIZE);
+	tree=buildTestTreeRandom(TEST_SIZE);
+	bytes=treeMemoryUsage(tree);
+	printf("Memory used: %.1f MB\n",bytes/1048576.0);
+	printf("Bytes per key: %.2f\n",(double)bytes/TEST_SIZE);
+	keys=NewArray(TEST_SIZE,int);
+	for(i=0;i<TEST_SIZE;i++)
+		keys[i]=RandomInteger(-9000000,9000000);
+	start=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		findNode(tree,keys[i]);
+	elapsed=wallClock()-start;
+	printf("Random lookups: %.0f ns per findNode\n",elapsed*1e9/TEST_SIZE);
+	FreeBlock(keys);
+	freeTree(tree);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+void genericTest(void){
+	int i,TEST_SIZE,*keys;
+
+	system("cls");
+	printf("Generic Tree Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,int);
+	for(i=0;i<TEST_SIZE;i++)
+		keys[i]=RandomInteger(-9000000,9000000);
+	printf("Random input || Tree size: %d || ns per operation\n",TEST_SIZE);
+	printf("%-24s%10s%10s%10s\n","Tree","Insert","Find","Delete");
+	timeRedBlack(keys,TEST_SIZE);
+	timeIntSet(keys,TEST_SIZE);
+	timeLongMap(keys,TEST_SIZE);
+	timeRealMap(keys,TEST_SIZE);
+	timeVersionMap(keys,TEST_SIZE);
+	printf("\nInsert or update every key twice || ns per operation\n");
+	timeUpsert(keys,TEST_SIZE);
+	FreeBlock(keys);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: orderTest
+ * -------------------
+ * Times treeSelect and treeRank against insert and delete.
+ * Only a limited number of queries are made since they are
+ * O(n) unless redblack.c is built with RB_ORDER_STATISTICS.
+ */
+void orderTest(void){
+	treeADT tree;
+	int i,k,TEST_SIZE,QUERIES,*keys;
+	double times[5];
+
+	system("cls");
+	printf("Order Statistics Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter number of queries: ");
+	QUERIES=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || QUERIES<=0)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,int);
+	for(i=0;i<TEST_SIZE;i++)
+		keys[i]=RandomInteger(-9000000,9000000);
+	tree=newTree();
+	times[0]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,keys[i]);
+	times[1]=wallClock();
+	for(i=0;i<QUERIES;i++){
+		k=RandomInteger(0,TEST_SIZE-1);
+		if(treeRank(tree,treeSelect(tree,k))>(size_t)k)
+			Error("Rank of element %d is wrong!",k);
+	}
+	times[2]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		treeRank(tree,keys[RandomInteger(0,TEST_SIZE-1)]);
+	times[3]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeDelete(tree,keys[i]);
+	times[4]=wallClock();
+	freeTree(tree);
+	FreeBlock(keys);
+	printf("Random input || Tree size: %d || Queries: %d\n",TEST_SIZE,QUERIES);
+	printf("%-16s%10.0f ns\n","Insert",(times[1]-times[0])*1e9/TEST_SIZE);
+	printf("%-16s%10.0f ns\n","Select + Rank",(times[2]-times[1])*1e9/QUERIES);
+	printf("%-16s%10.0f ns\n","Rank",(times[3]-times[2])*1e9/QUERIES);
+	printf("%-16s%10.0f ns\n","Delete",(times[4]-times[3])*1e9/TEST_SIZE);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: scanTest
+ * -------------------
+ * Times a full scan in both directions with a cursor and
+ * checks that the values come out sorted.
+ */
+void scanTest(void){
+	treeADT tree;
+	cursorT cursor;
+	int TEST_SIZE;
+	elementT last;
+	double sum=0,start,forward,backward;
+
+	system("cls");
+	printf("Tree Scan Tester\n\n");
+	printf("Enter tree size (rec.: 10000000): ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	tree=buildTestTreeRandom(TEST_SIZE);
+	start=wallClock();
+	last=treePeekMin(tree);
+	for(cursor=treeFirst(tree);cursorValid(cursor);cursorNext(&cursor)){
+		if(cursorKey(cursor)<last)
+			Error("Scan out of order!");
+		last=cursorKey(cursor);
+		sum+=last;
+	}
+	forward=wallClock()-start;
+	start=wallClock();
+	for(cursor=treeLast(tree);cursorValid(cursor);cursorPrev(&cursor))
+		sum-=cursorKey(cursor);
+	backward=wallClock()-start;
+	if(sum!=0)
+		Error("Scans disagree!");
+	freeTree(tree);
+	printf("Random input || Tree size: %d\n",TEST_SIZE);
+	printf("Forward scan: %.1f ns per key (%.0f keys/s)\n",forward*1e9/TEST_SIZE,TEST_SIZE/forward);
+	printf("Backward scan: %.1f ns per key (%.0f keys/s)\n",backward*1e9/TEST_SIZE,TEST_SIZE/backward);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: rangeTest
+ * -------------------
+ * Times random range queries of a given width, answered by
+ * treeRangeCount, by treeRangeScan and by a full scan.
+ */
+void rangeTest(void){
+	treeADT tree;
+	cursorT cursor;
+	int i,TEST_SIZE,QUERIES,WIDTH,*starts;
+	size_t counted=0,scanned=0,full=0;
+	double times[4];
+
+	system("cls");
+	printf("Range Query Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter number of queries: ");
+	QUERIES=GetInteger();
+	printf("Enter range width (keys are in -9000000..9000000): ");
+	WIDTH=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || QUERIES<=0 || WIDTH<=0)
+		Error("I refuse!");
+
+	tree=buildTestTreeRandom(TEST_SIZE);
+	starts=NewArray(QUERIES,int);
+	for(i=0;i<QUERIES;i++)
+		starts[i]=RandomInteger(-9000000,9000000);
+	times[0]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		counted+=treeRangeCount(tree,starts[i],starts[i]+WIDTH);
+	times[1]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		treeRangeScan(tree,starts[i],starts[i]+WIDTH,countValue,&scanned);
+	times[2]=wallClock();
+	for(i=0;i<QUERIES && i<10;i++)
+		for(cursor=treeFirst(tree);cursorValid(cursor);cursorNext(&cursor))
+			if(cursorKey(cursor)>=starts[i] && cursorKey(cursor)<starts[i]+WIDTH)
+				full++;
+	times[3]=wallClock();
+	if(counted!=scanned)
+		Error("Range count and range scan disagree!");
+	FreeBlock(starts);
+	freeTree(tree);
+	printf("Random input || Tree size: %d || Queries: %d || Keys found: %.1f per query\n",
+		TEST_SIZE,QUERIES,(double)counted/QUERIES);
+	printf("%-16s%12.0f ns per query\n","treeRangeCount",(times[1]-times[0])*1e9/QUERIES);
+	printf("%-16s%12.0f ns per query\n","treeRangeScan",(times[2]-times[1])*1e9/QUERIES);
+	printf("%-16s%12.0f ns per query\n","Full scan",(times[3]-times[2])*1e9/i);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+void countValue(elementT value, void *clientData){
+	size_t *count=clientData;
+
+	(void)value;
+	(*count)++;
+}
+
+/*
+ * Function: bulkLoadTest
+ * -------------------
+ * Compares building a tree from a sorted snapshot with
+ * treeBuildFromSorted against inserting the values one by one,
+ * and times a full scan of both trees.
+ */
+void bulkLoadTest(void){
+	treeADT inserted,built;
+	elementT *values;
+	int i,TEST_SIZE;
+	double start,insertTime,buildTime;
+
+	system("cls");
+	printf("Bulk Load Tester\n\n");
+	printf("Enter tree size (rec.: 10000000): ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	values=NewArray(TEST_SIZE,elementT);
+	for(i=0;i<TEST_SIZE;i++)
+		values[i]=2*i;
+	start=wallClock();
+	inserted=newTree();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(inserted,values[i]);
+	insertTime=wallClock()-start;
+	start=wallClock();
+	built=treeBuildFromSorted(values,TEST_SIZE);
+	buildTime=wallClock()-start;
+	FreeBlock(values);
+	printf("Sorted input || Tree size: %d\n",TEST_SIZE);
+	printf("%-20s%10s%10s%16s\n","","Load (s)","Height","Scan (ns/key)");
+	printf("%-20s%10.3f%10d%16.1f\n","treeInsert loop",insertTime,
+		treeHeight(inserted),timeScan(inserted)*1e9/TEST_SIZE);
+	printf("%-20s%10.3f%10d%16.1f\n","treeBuildFromSorted",buildTime,
+		treeHeight(built),timeScan(built)*1e9/TEST_SIZE);
+	printf("Speedup: %.1f\n",insertTime/buildTime);
+	freeTree(inserted);
+	freeTree(built);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+double timeScan(treeADT tree){
+	cursorT cursor;
+	double start,elapsed;
+	size_t n=0;
+
+	start=wallClock();
+	for(cursor=treeFirst(tree);cursorValid(cursor);cursorNext(&cursor))
+		if(cursorKey(cursor)>=0)
+			n++;
+	elapsed=wallClock()-start;
+	if(n!=treeSize(tree))
+		Error("Scan lost keys!");
+	return (elapsed);
+}
+
+/*
+ * Function: setTest
+ * -------------------
+ * Times the set operations on two trees of random values
+ * against inserting every value of one tree into the other,
+ * and a split at the median followed by a join.
+ */
+void setTest(void){
+	treeADT a,b,lt,gt;
+	elementT *valuesA,*valuesB,median;
+	cursorT cursor;
+	int TEST_SIZE;
+	double start;
+
+	system("cls");
+	printf("Set Operations Tester\n\n");
+	printf("Enter tree size (rec.: 10000000): ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	valuesA=NewArray(TEST_SIZE,elementT);
+	valuesB=NewArray(TEST_SIZE,elementT);
+	fillSorted(valuesA,TEST_SIZE);
+	fillSorted(valuesB,TEST_SIZE);
+	printf("Random input || Tree sizes: %d || Processors: %d\n",TEST_SIZE,processorCount());
+
+	a=treeBuildFromSorted(valuesA,TEST_SIZE);
+	b=treeBuildFromSorted(valuesB,TEST_SIZE);
+	start=wallClock();
+	for(cursor=treeFirst(b);cursorValid(cursor);cursorNext(&cursor))
+		treeInsertUnique(a,cursorKey(cursor));
+	printf("%-20s%10.3f s || %d values\n","Insert loop",wallClock()-start,(int)treeSize(a));
+	freeTree(a);
+	freeTree(b);
+
+	a=treeBuildFromSorted(valuesA,TEST_SIZE);
+	b=treeBuildFromSorted(valuesB,TEST_SIZE);
+	start=wallClock();
+	a=treeUnion(a,b);
+	printf("%-20s%10.3f s || %d values\n","treeUnion",wallClock()-start,(int)treeSize(a));
+	freeTree(a);
+
+	a=treeBuildFromSorted(valuesA,TEST_SIZE);
+	b=treeBuildFromSorted(valuesB,TEST_SIZE);
+	start=wallClock();
+	a=treeIntersection(a,b);
+	printf("%-20s%10.3f s || %d values\n","treeIntersection",wallClock()-start,(int)treeSize(a));
+	freeTree(a);
+
+	a=treeBuildFromSorted(valuesA,TEST_SIZE);
+	b=treeBuildFromSorted(valuesB,TEST_SIZE);
+	start=wallClock();
+	a=treeDifference(a,b);
+	printf("%-20s%10.3f s || %d values\n","treeDifference",wallClock()-start,(int)treeSize(a));
+	freeTree(a);
+
+	a=treeBuildFromSorted(valuesA,TEST_SIZE);
+	median=valuesA[TEST_SIZE/2];
+	start=wallClock();
+	treeSplit(a,median,&lt,&gt);
+	a=treeJoin(lt,median,gt);
+	printf("%-20s%10.1f us\n","Split + join",(wallClock()-start)*1e6);
+	freeTree(a);
+	FreeBlock(valuesA);
+	FreeBlock(valuesB);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: fillSorted
+ * -------------------
+ * Fills the array with increasing random values, about two
+ * apart, so that two such arrays share about half their values.
+ */
+void fillSorted(elementT values[], int n){
+	int i;
+
+	values[0]=RandomInteger(0,3);
+	for(i=1;i<n;i++)
+		values[i]=values[i-1]+RandomInteger(1,3);
+}
+
+/*
+ * Function: hintTest
+ * -------------------
+ * Compares treeInsert with treeInsertHint, given the cursor
+ * of the previous insert, for ordered, reversed and random
+ * input and for ascending runs starting at random values.
+ * Comparisons are only counted when redblack.c is built with
+ * RB_COUNT_COMPARISONS.
+ */
+void hintTest(void){
+	elementT *values;
+	int i,TEST_SIZE;
+
+	system("cls");
+	printf("Hinted Insert Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	values=NewArray(TEST_SIZE,elementT);
+	printf("Tree size: %d || ns and comparisons per insert\n",TEST_SIZE);
+	printf("%-12s%14s%14s%14s%14s\n","Input","treeInsert","comparisons","with hint","comparisons");
+	for(i=0;i<TEST_SIZE;i++)
+		values[i]=i;
+	timeHints("Ordered",values,TEST_SIZE);
+	for(i=0;i<TEST_SIZE;i++)
+		values[i]=TEST_SIZE-1-i;
+	timeHints("Reversed",values,TEST_SIZE);
+	for(i=0;i<TEST_SIZE;i++)
+		values[i]=RandomInteger(-9000000,9000000);
+	timeHints("Random",values,TEST_SIZE);
+	for(i=0;i<TEST_SIZE;i++)
+		values[i]=(i%64==0) ? RandomInteger(-9000000,9000000) : values[i-1]+1;
+	timeHints("Runs of 64",values,TEST_SIZE);
+	FreeBlock(values);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+void timeHints(string name, elementT values[], int n){
+	treeADT plain,hinted;
+	cursorT cursor;
+	double start,plainTime,hintTime;
+	int i;
+
+	plain=newTree();
+	start=wallClock();
+	for(i=0;i<n;i++)
+		treeInsert(plain,values[i]);
+	plainTime=wallClock()-start;
+	hinted=newTree();
+	cursor=treeFirst(hinted);
+	start=wallClock();
+	for(i=0;i<n;i++)
+		cursor=treeInsertHint(hinted,cursor,values[i]);
+	hintTime=wallClock()-start;
+	printf("%-12s%14.1f%14.2f%14.1f%14.2f\n",name,plainTime*1e9/n,
+		(double)treeComparisons(plain)/n,hintTime*1e9/n,(double)treeComparisons(hinted)/n);
+	freeTree(plain);
+	freeTree(hinted);
+}
+
+/*
+ * Function: handleTest
+ * -------------------
+ * Simulates a timer queue with many equal deadlines. Every
+ * timer is moved to a later deadline and then cancelled,
+ * once through the handles and once by searching values.
+ */
+void handleTest(void){
+	treeADT tree;
+	cursorT *handles;
+	elementT *deadlines;
+	int i,TEST_SIZE;
+	double times[5];
+
+	system("cls");
+	printf("Handle Tester\n\n");
+	printf("Enter number of timers: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	handles=NewArray(TEST_SIZE,cursorT);
+	deadlines=NewArray(TEST_SIZE,elementT);
+	for(i=0;i<TEST_SIZE;i++)
+		deadlines[i]=RandomInteger(0,TEST_SIZE/16);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++)
+		handles[i]=treeInsert(tree,deadlines[i]);
+	times[0]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeUpdateKey(handles[i],deadlines[i]+i%8);
+	times[1]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeDeleteNode(tree,handles[i]);
+	times[2]=wallClock();
+	freeTree(tree);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,deadlines[i]);
+	times[3]=wallClock();
+	for(i=0;i<TEST_SIZE;i++){
+		treeDelete(tree,deadlines[i]);
+		treeInsert(tree,deadlines[i]+i%8);
+	}
+	times[4]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeDelete(tree,deadlines[i]+i%8);
+	printf("Timers: %d || Distinct deadlines: %d || ns per operation\n",TEST_SIZE,TEST_SIZE/16+1);
+	printf("%-32s%10.0f\n","treeUpdateKey",(times[1]-times[0])*1e9/TEST_SIZE);
+	printf("%-32s%10.0f\n","treeDelete + treeInsert",(times[4]-times[3])*1e9/TEST_SIZE);
+	printf("%-32s%10.0f\n","treeDeleteNode",(times[2]-times[1])*1e9/TEST_SIZE);
+	printf("%-32s%10.0f\n","treeDelete",(wallClock()-times[4])*1e9/TEST_SIZE);
+	freeTree(tree);
+	FreeBlock(handles);
+	FreeBlock(deadlines);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: engineTest
+ * -------------------
+ * Runs the same random inserts, lookups and deletes on the
+ * bottom-up engine of redblack.h and the top-down engine of
+ * topdown.h.
+ */
+void engineTest(void){
+	treeADT tree;
+	tdTreeADT tdTree;
+	int *keys;
+	int i,height,TEST_SIZE;
+	double times[4],memory;
+
+	system("cls");
+	printf("Top-Down Engine Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,int);
+	for(i=0;i<TEST_SIZE;i++)
+		keys[i]=RandomInteger(-9000000,9000000);
+	printf("Tree size: %d || ns per operation\n",TEST_SIZE);
+	printf("%-12s%12s%12s%12s%12s%12s\n","Engine","insert","lookup","delete","height","bytes/node");
+
+	tree=newTree();
+	times[0]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,keys[i]);
+	times[1]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		findNode(tree,keys[i]);
+	times[2]=wallClock();
+	memory=(double)treeMemoryUsage(tree)/TEST_SIZE;
+	height=treeHeight(tree);
+	printf("%-12s%12.0f%12.0f","Bottom-up",(times[1]-times[0])*1e9/TEST_SIZE,
+		(times[2]-times[1])*1e9/TEST_SIZE);
+	times[3]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		treeDelete(tree,keys[i]);
+	printf("%12.0f%12d%12.1f\n",(wallClock()-times[3])*1e9/TEST_SIZE,height,memory);
+	freeTree(tree);
+
+	tdTree=newTdTree();
+	times[0]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		tdInsert(tdTree,keys[i]);
+	times[1]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		tdFind(tdTree,keys[i]);
+	times[2]=wallClock();
+	memory=(double)tdMemoryUsage(tdTree)/TEST_SIZE;
+	height=tdHeight(tdTree);
+	printf("%-12s%12.0f%12.0f","Top-down",(times[1]-times[0])*1e9/TEST_SIZE,
+		(times[2]-times[1])*1e9/TEST_SIZE);
+	times[3]=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		tdDelete(tdTree,keys[i]);
+	printf("%12.0f%12d%12.1f\n",(wallClock()-times[3])*1e9/TEST_SIZE,height,memory);
+	freeTdTree(tdTree);
+	FreeBlock(keys);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: descentTest
+ * -------------------
+ * Times the descents of findNode, treeInsert and treeDelete
+ * on random keys, where the direction taken at each level
+ * can't be predicted. Half of the lookups miss.
+ */
+void descentTest(void){
+	treeADT tree;
+	int *keys,*queries;
+	int i,TEST_SIZE;
+	double times[4];
+	uint64_t cycles[4];
+
+	system("cls");
+	printf("Descent Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,int);
+	queries=NewArray(TEST_SIZE,int);
+	for(i=0;i<TEST_SIZE;i++){
+		keys[i]=RandomInteger(-9000000,9000000);
+		queries[i]=(i%2==0) ? keys[RandomInteger(0,i)] : RandomInteger(-9000000,9000000);
+	}
+	tree=newTree();
+	times[0]=wallClock();
+	cycles[0]=cycleCount();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,keys[i]);
+	times[1]=wallClock();
+	cycles[1]=cycleCount();
+	for(i=0;i<TEST_SIZE;i++)
+		findNode(tree,queries[i]);
+	times[2]=wallClock();
+	cycles[2]=cycleCount();
+	for(i=0;i<TEST_SIZE;i++)
+		treeDelete(tree,keys[i]);
+	times[3]=wallClock();
+	cycles[3]=cycleCount();
+	printf("Tree size: %d || per operation\n",TEST_SIZE);
+	printf("%-12s%12s%12s\n","Operation","ns","cycles");
+	printf("%-12s%12.0f%12.0f\n","treeInsert",(times[1]-times[0])*1e9/TEST_SIZE,(double)(cycles[1]-cycles[0])/TEST_SIZE);
+	printf("%-12s%12.0f%12.0f\n","findNode",(times[2]-times[1])*1e9/TEST_SIZE,(double)(cycles[2]-cycles[1])/TEST_SIZE);
+	printf("%-12s%12.0f%12.0f\n","treeDelete",(times[3]-times[2])*1e9/TEST_SIZE,(double)(cycles[3]-cycles[2])/TEST_SIZE);
+	freeTree(tree);
+	FreeBlock(keys);
+	FreeBlock(queries);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: batchTest
+ * -------------------
+ * Looks up the same random values, half of them in the tree,
+ * with a loop over findNode and with findNodeBatch. The tree
+ * should be larger than the last level cache to show the
+ * effect of overlapping the misses.
+ */
+void batchTest(void){
+	treeADT tree;
+	elementT *queries,*results;
+	int i,TEST_SIZE,QUERIES;
+	double times[3];
+
+	system("cls");
+	printf("Batch Lookup Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter number of lookups: ");
+	QUERIES=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || QUERIES<=0)
+		Error("I refuse!");
+
+	queries=NewArray(QUERIES,elementT);
+	results=NewArray(QUERIES,elementT);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++){
+		treeInsert(tree,RandomInteger(0,2*TEST_SIZE));
+		if(i<QUERIES)
+			queries[i]=RandomInteger(0,2*TEST_SIZE);
+	}
+	for(;i<QUERIES;i++)
+		queries[i]=RandomInteger(0,2*TEST_SIZE);
+	times[0]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		results[i]=findNode(tree,queries[i]);
+	times[1]=wallClock();
+	findNodeBatch(tree,queries,QUERIES,results);
+	times[2]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		if(results[i]!=findNode(tree,queries[i]))
+			Error("Batch lookup disagrees with findNode!");
+	printf("Tree size: %d || Memory: %.0f MB || million lookups per second\n",
+		TEST_SIZE,treeMemoryUsage(tree)/1e6);
+	printf("%-20s%10.2f\n","findNode loop",QUERIES/(times[1]-times[0])/1e6);
+	printf("%-20s%10.2f\n","findNodeBatch",QUERIES/(times[2]-times[1])/1e6);
+	freeTree(tree);
+	FreeBlock(queries);
+	FreeBlock(results);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: sortedBatchTest
+ * -------------------
+ * Looks up sorted batches of growing density with a loop over
+ * findNode, with findNodeBatch and with treeFindSorted.
+ */
+void sortedBatchTest(void){
+	treeADT tree;
+	elementT *queries,*results;
+	int i,n,TEST_SIZE;
+
+	system("cls");
+	printf("Sorted Batch Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	queries=NewArray(TEST_SIZE,elementT);
+	results=NewArray(TEST_SIZE,elementT);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,RandomInteger(0,2*TEST_SIZE));
+	printf("Tree size: %d || ns per lookup\n",TEST_SIZE);
+	printf("%-12s%16s%16s%16s\n","Batch","findNode loop","findNodeBatch","treeFindSorted");
+	for(n=TEST_SIZE/1000;n<TEST_SIZE;n*=10)
+		if(n>0)
+			timeSortedBatch(tree,queries,results,n,2*TEST_SIZE);
+	timeSortedBatch(tree,queries,results,TEST_SIZE,2*TEST_SIZE);
+	freeTree(tree);
+	FreeBlock(queries);
+	FreeBlock(results);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: timeSortedBatch
+ * -------------------
+ * Fills queries with n increasing random values spread over
+ * 0..range, times the three lookups and prints one row.
+ */
+void timeSortedBatch(treeADT tree, elementT queries[], elementT results[],
+                     int n, int range){
+	double times[4];
+	int i,step;
+
+	step=range/n;
+	queries[0]=RandomInteger(0,step);
+	for(i=1;i<n;i++)
+		queries[i]=queries[i-1]+RandomInteger(0,2*step);
+	times[0]=wallClock();
+	for(i=0;i<n;i++)
+		results[i]=findNode(tree,queries[i]);
+	times[1]=wallClock();
+	findNodeBatch(tree,queries,n,results);
+	times[2]=wallClock();
+	treeFindSorted(tree,queries,n,results);
+	times[3]=wallClock();
+	for(i=0;i<n;i++)
+		if(results[i]!=findNode(tree,queries[i]))
+			Error("Sorted lookup disagrees with findNode!");
+	printf("%-12d%16.1f%16.1f%16.1f\n",n,(times[1]-times[0])*1e9/n,
+		(times[2]-times[1])*1e9/n,(times[3]-times[2])*1e9/n);
+}
+
+/*
+ * Function: frozenTest
+ * -------------------
+ * Compares lookups, lower bounds and range counts in a tree
+ * of random values with the same queries in its snapshot.
+ */
+void frozenTest(void){
+	treeADT tree;
+	frozenADT frozen;
+	elementT *queries;
+	int i,TEST_SIZE,QUERIES;
+	size_t total[2];
+	double times[8];
+
+	system("cls");
+	printf("Frozen Snapshot Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter number of queries: ");
+	QUERIES=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || QUERIES<=0)
+		Error("I refuse!");
+
+	queries=NewArray(QUERIES,elementT);
+	for(i=0;i<QUERIES;i++)
+		queries[i]=RandomInteger(0,2*TEST_SIZE);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++)
+		treeInsert(tree,RandomInteger(0,2*TEST_SIZE));
+	times[0]=wallClock();
+	frozen=treeFreeze(tree);
+	times[1]=wallClock();
+	printf("Tree size: %d || Freeze: %.1f ms || ns per query\n",TEST_SIZE,(times[1]-times[0])*1e3);
+	printf("%-20s%14s%14s\n","Query","tree","snapshot");
+
+	total[0]=total[1]=0;
+	times[0]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[0]+=(findNode(tree,queries[i])!=NOT_FOUND);
+	times[1]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[1]+=(frozenFind(frozen,queries[i])!=NOT_FOUND);
+	times[2]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[0]+=cursorValid(treeLowerBound(tree,queries[i]));
+	times[3]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[1]+=(frozenLowerBound(frozen,queries[i])<frozenSize(frozen));
+	times[4]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[0]+=treeRangeCount(tree,queries[i],queries[i]+64);
+	times[5]=wallClock();
+	for(i=0;i<QUERIES;i++)
+		total[1]+=frozenRangeCount(frozen,queries[i],queries[i]+64);
+	times[6]=wallClock();
+	if(total[0]!=total[1])
+		Error("Snapshot disagrees with the tree!");
+	printf("%-20s%14.1f%14.1f\n","find",(times[1]-times[0])*1e9/QUERIES,(times[2]-times[1])*1e9/QUERIES);
+	printf("%-20s%14.1f%14.1f\n","lower bound",(times[3]-times[2])*1e9/QUERIES,(times[4]-times[3])*1e9/QUERIES);
+	printf("%-20s%14.1f%14.1f\n","range count of 64",(times[5]-times[4])*1e9/QUERIES,(times[6]-times[5])*1e9/QUERIES);
+	printf("%-20s%14.1f%14.1f\n","bytes per value",(double)treeMemoryUsage(tree)/TEST_SIZE,
+		(double)frozenMemoryUsage(frozen)/TEST_SIZE);
+	freeFrozen(frozen);
+	freeTree(tree);
+	FreeBlock(queries);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: compactTest
+ * -------------------
+ * Scatters the nodes of a tree by deleting and inserting
+ * random values, then times lookups and a full scan before
+ * and after treeCompact. Finally the tree is scattered again
+ * and compacted in steps between inserts and deletes, to find
+ * the longest pause.
+ */
+void compactTest(void){
+	treeADT tree;
+	elementT *keys;
+	int i,steps,TEST_SIZE;
+	double start,pause,longest;
+
+	system("cls");
+	printf("Compaction Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,elementT);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++){
+		keys[i]=RandomInteger(0,9000000);
+		treeInsert(tree,keys[i]);
+	}
+	churnKeys(tree,keys,TEST_SIZE,2*TEST_SIZE);
+	printf("Tree size: %d || ns per value\n",TEST_SIZE);
+	printf("%-20s%12s%12s%12s\n","","lookup","scan","bytes");
+	printf("%-20s%12.1f%12.1f%12.1f\n","Scattered",timeLookups(tree,keys,TEST_SIZE),
+		timeScan(tree)*1e9/TEST_SIZE,(double)treeMemoryUsage(tree)/TEST_SIZE);
+	start=wallClock();
+	treeCompact(tree);
+	pause=wallClock()-start;
+	printf("%-20s%12.1f%12.1f%12.1f\n","Compacted",timeLookups(tree,keys,TEST_SIZE),
+		timeScan(tree)*1e9/TEST_SIZE,(double)treeMemoryUsage(tree)/TEST_SIZE);
+	printf("treeCompact: %.1f ms\n\n",pause*1e3);
+
+	churnKeys(tree,keys,TEST_SIZE,2*TEST_SIZE);
+	steps=0;
+	longest=0;
+	do {
+		churnKeys(tree,keys,TEST_SIZE,1);
+		steps++;
+		start=wallClock();
+		i=treeCompactStep(tree,1024);
+		pause=wallClock()-start;
+		if(pause>longest)
+			longest=pause;
+	} while(!i);
+	printf("treeCompactStep(1024) between writes: %d steps, longest %.1f us\n",steps,longest*1e6);
+	printf("%-20s%12.1f%12.1f%12.1f\n","Compacted in steps",timeLookups(tree,keys,TEST_SIZE),
+		timeScan(tree)*1e9/TEST_SIZE,(double)treeMemoryUsage(tree)/TEST_SIZE);
+	freeTree(tree);
+	FreeBlock(keys);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: churnKeys
+ * -------------------
+ * Replaces random values of the tree by new random values
+ * the given number of times. keys holds the values of the tree.
+ */
+void churnKeys(treeADT tree, elementT keys[], int n, int rounds){
+	int i,k;
+
+	for(i=0;i<rounds;i++){
+		k=RandomInteger(0,n-1);
+		treeDelete(tree,keys[k]);
+		keys[k]=RandomInteger(0,9000000);
+		treeInsert(tree,keys[k]);
+	}
+}
+
+/*
+ * Function: timeLookups
+ * -------------------
+ * Looks up the n values in random order and returns the
+ * time per lookup in ns.
+ */
+double timeLookups(treeADT tree, elementT keys[], int n){
+	double start;
+	int i,step;
+
+	step=(n%7919==0) ? 1 : 7919;
+	start=wallClock();
+	for(i=0;i<n;i++)
+		findNode(tree,keys[(size_t)i*step%n]);
+	return ((wallClock()-start)*1e9/n);
+}
+
+/*
+ * Function: persistTest
+ * -------------------
+ * Measures how many nodes a persistent update copies and how
+ * long it takes next to an update in place, what a snapshot
+ * costs, and how many lookups reader threads get done in
+ * snapshots with and without a writer changing the tree.
+ */
+void persistTest(void){
+	liveTreeADT live;
+	versionADT snapshot;
+	treeADT tree;
+	elementT *keys;
+	int i,n,TEST_SIZE,NUM_OF_THREADS;
+	double start,alone,shared,updates;
+
+	system("cls");
+	printf("Persistent Tree Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter max number of reader threads (max: %d): ",MAX_THREADS-1);
+	NUM_OF_THREADS=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || NUM_OF_THREADS<=0 || NUM_OF_THREADS>=MAX_THREADS)
+		Error("I refuse!");
+
+	keys=NewArray(TEST_SIZE,elementT);
+	live=newLiveTree();
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++){
+		keys[i]=RandomInteger(0,9000000);
+		liveInsert(live,keys[i]);
+		treeInsert(tree,keys[i]);
+	}
+	printf("Tree size: %d || Height of the in-place tree: %d\n",TEST_SIZE,treeHeight(tree));
+	printf("%-24s%14s%14s\n","","nodes copied","ns per op");
+	snapshot=liveSnapshot(live);
+	timeVersions(snapshot,keys,TEST_SIZE);
+	start=wallClock();
+	for(i=0;i<TEST_SIZE;i++){
+		treeDelete(tree,keys[i]);
+		treeInsert(tree,keys[i]);
+	}
+	printf("%-24s%14s%14.1f\n","in-place update","-",(wallClock()-start)*1e9/(2.0*TEST_SIZE));
+	versionRelease(snapshot);
+	freeTree(tree);
+
+	start=wallClock();
+	for(i=0;i<TEST_SIZE;i++)
+		versionRelease(liveSnapshot(live));
+	printf("%-24s%14s%14.1f\n\n","snapshot + release","0",(wallClock()-start)*1e9/TEST_SIZE);
+
+	printf("%-10s%18s%18s%18s\n","Readers","lookups/s alone","with writer","writer updates/s");
+	for(n=1;n<=NUM_OF_THREADS;n*=2){
+		alone=runReaders(live,n,FALSE,&updates);
+		shared=runReaders(live,n,TRUE,&updates);
+		printf("%-10d%18.0f%18.0f%18.0f\n",n,alone,shared,updates);
+	}
+	freeLiveTree(live);
+	FreeBlock(keys);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: timeVersions
+ * -------------------
+ * Deletes and reinserts every key, each time making a new
+ * version from the last one, and prints the nodes copied and
+ * the time per update. The given version is not changed.
+ */
+void timeVersions(versionADT version, elementT keys[], int n){
+	versionADT newer;
+	double start,copies[2],times[2];
+	int i;
+
+	version=versionRetain(version);
+	copies[0]=copies[1]=times[0]=times[1]=0;
+	for(i=0;i<n;i++){
+		start=wallClock();
+		newer=versionDelete(version,keys[i]);
+		times[0]+=wallClock()-start;
+		copies[0]+=versionCopies(newer);
+		versionRelease(version);
+		start=wallClock();
+		version=versionInsert(newer,keys[i]);
+		times[1]+=wallClock()-start;
+		copies[1]+=versionCopies(version);
+		versionRelease(newer);
+	}
+	if(versionBlackHeight(version)<0 || versionSize(version)!=(size_t)n)
+		Error("Versions are broken!");
+	versionRelease(version);
+	printf("%-24s%14.1f%14.1f\n","versionDelete",copies[0]/n,times[0]*1e9/n);
+	printf("%-24s%14.1f%14.1f\n","versionInsert",copies[1]/n,times[1]*1e9/n);
+}
+
+/*
+ * Function: runReaders
+ * -------------------
+ * Runs the given number of reader threads, and a writer if
+ * asked, for one second. Returns the lookups per second of
+ * all readers together and sets updates to the writer's.
+ */
+double runReaders(liveTreeADT live, int readers, bool writer, double *updates){
+	threadADT threads[MAX_THREADS];
+	mvccT work[MAX_THREADS];
+	double lookups=0;
+	int i,n;
+
+	n=readers+(writer ? 1 : 0);
+	for(i=0;i<n;i++){
+		work[i].live=live;
+		work[i].seed=i+1;
+		work[i].deadline=wallClock()+1.0;
+		work[i].operations=0;
+		threads[i]=newThread(i<readers ? readSnapshots : writeVersions,&work[i]);
+	}
+	for(i=0;i<n;i++)
+		joinThread(threads[i]);
+	for(i=0;i<readers;i++)
+		lookups+=work[i].operations;
+	*updates=writer ? work[readers].operations : 0;
+	return (lookups);
+}
+
+/*
+ * Function: readSnapshots
+ * -------------------
+ * Takes a snapshot, looks up 1000 random values in it and
+ * lets it go, until the deadline.
+ */
+void readSnapshots(void *arg){
+	mvccT *work=arg;
+	versionADT snapshot;
+	int i;
+
+	while(wallClock()<work->deadline){
+		snapshot=liveSnapshot(work->live);
+		for(i=0;i<1000;i++)
+			versionFind(snapshot,nextRandom(&work->seed));
+		versionRelease(snapshot);
+		work->operations+=1000;
+	}
+}
+
+/*
+ * Function: writeVersions
+ * -------------------
+ * Inserts a random value and deletes it again, until the
+ * deadline. Every update publishes a new version.
+ */
+void writeVersions(void *arg){
+	mvccT *work=arg;
+	elementT value;
+
+	while(wallClock()<work->deadline){
+		value=nextRandom(&work->seed);
+		liveInsert(work->live,value);
+		liveDelete(work->live,value);
+		work->operations+=2;
+	}
+}
+
+/*
+ * Function: sharedTest
+ * -------------------
+ * Runs a read-mostly workload, 95% lookups and 5% writes, on
+ * one tree from 1 up to the given number of threads, once
+ * with a mutex around every operation and once as a shared
+ * tree whose readers take no lock.
+ */
+void sharedTest(void){
+	sharedTreeADT shared;
+	treeADT tree;
+	mutexADT lock;
+	size_t retries;
+	int i,n,TEST_SIZE,NUM_OF_THREADS;
+	double locked,optimistic,base[2];
+	elementT value;
+
+	system("cls");
+	printf("Shared Tree Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter max number of threads (max: %d): ",MAX_THREADS);
+	NUM_OF_THREADS=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || NUM_OF_THREADS<=0 || NUM_OF_THREADS>MAX_THREADS)
+		Error("I refuse!");
+
+	shared=newSharedTree();
+	tree=newTree();
+	lock=newMutex();
+	for(i=0;i<TEST_SIZE;i++){
+		value=RandomInteger(0,9000000);
+		sharedInsert(shared,value);
+		treeInsert(tree,value);
+	}
+	printf("Tree size: %d || Operations per thread: %d || Processors: %d\n",
+		TEST_SIZE,SHARED_OPERATIONS,processorCount());
+	printf("%-10s%16s%10s%16s%10s%12s\n","Threads","mutex ops/s","speedup",
+		"seqlock ops/s","speedup","retries");
+	for(n=1;n<=NUM_OF_THREADS;n=(n<NUM_OF_THREADS && 2*n>NUM_OF_THREADS) ? NUM_OF_THREADS : 2*n){
+		locked=runReadMostly(NULL,tree,lock,n,&retries);
+		optimistic=runReadMostly(shared,NULL,NULL,n,&retries);
+		if(n==1){
+			base[0]=locked;
+			base[1]=optimistic;
+		}
+		printf("%-10d%16.0f%10.2f%16.0f%10.2f%12lu\n",n,locked,locked/base[0],
+			optimistic,optimistic/base[1],(unsigned long)retries);
+	}
+	freeSharedTree(shared);
+	freeTree(tree);
+	freeMutex(lock);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: runReadMostly
+ * -------------------
+ * Runs n threads on the shared tree, or on the tree behind
+ * the lock if shared is NULL, and returns the operations per
+ * second of all threads together. retries is set to the
+ * number of lookups the readers had to redo.
+ */
+double runReadMostly(sharedTreeADT shared, treeADT tree, mutexADT lock,
+                     int n, size_t *retries){
+	threadADT threads[MAX_THREADS];
+	readMostlyT work[MAX_THREADS];
+	double start;
+	int i;
+
+	start=wallClock();
+	for(i=0;i<n;i++){
+		work[i].shared=shared;
+		work[i].tree=tree;
+		work[i].lock=lock;
+		work[i].seed=i+1;
+		work[i].retries=0;
+		threads[i]=newThread(shared==NULL ? lockedReadMostly : sharedReadMostly,&work[i]);
+	}
+	*retries=0;
+	for(i=0;i<n;i++){
+		joinThread(threads[i]);
+		*retries+=work[i].retries;
+	}
+	return ((double)SHARED_OPERATIONS*n/(wallClock()-start));
+}
+
+/*
+ * Functions: lockedReadMostly, sharedReadMostly
+ * -------------------
+ * Look up random values, except that every 20th operation
+ * inserts a random value or deletes the one inserted before,
+ * so the tree keeps its size.
+ */
+void lockedReadMostly(void *arg){
+	readMostlyT *work=arg;
+	elementT value=0;
+	int i;
+
+	for(i=0;i<SHARED_OPERATIONS;i++){
+		lockMutex(work->lock);
+		if(i%40==19){
+			value=nextRandom(&work->seed);
+			treeInsert(work->tree,value);
+		} else if(i%40==39)
+			treeDelete(work->tree,value);
+		else
+			findNode(work->tree,nextRandom(&work->seed));
+		unlockMutex(work->lock);
+	}
+}
+
+void sharedReadMostly(void *arg){
+	readMostlyT *work=arg;
+	sharedReaderADT reader;
+	elementT value=0;
+	int i;
+
+	reader=newSharedReader(work->shared);
+	for(i=0;i<SHARED_OPERATIONS;i++){
+		if(i%40==19){
+			value=nextRandom(&work->seed);
+			sharedInsert(work->shared,value);
+		} else if(i%40==39)
+			sharedDelete(work->shared,value);
+		else
+			sharedFind(reader,nextRandom(&work->seed));
+	}
+	work->retries=sharedRetries(reader);
+	freeSharedReader(reader);
+}
+
+/*
+ * Function: shardedTest
+ * -------------------
+ * Inserts random values from 1 up to the given number of
+ * threads, once into one tree behind a mutex and once into a
+ * sharded tree. Then fills a sharded tree with values from a
+ * hundredth of the key range, rebalances it and checks its
+ * scans and range counts against a plain tree.
+ */
+void shardedTest(void){
+	shardedADT sharded;
+	treeADT tree;
+	mutexADT lock;
+	orderCheckT check;
+	int i,n,TEST_SIZE,NUM_OF_THREADS,NUM_OF_SHARDS;
+	double locked,split,base[2],start;
+	elementT value,lo,hi;
+
+	system("cls");
+	printf("Sharded Tree Tester\n\n");
+	printf("Enter number of values: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter max number of threads (max: %d): ",MAX_THREADS);
+	NUM_OF_THREADS=GetInteger();
+	printf("Enter number of shards: ");
+	NUM_OF_SHARDS=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<=0 || NUM_OF_THREADS<=0 || NUM_OF_THREADS>MAX_THREADS || NUM_OF_SHARDS<=0)
+		Error("I refuse!");
+
+	printf("Values: %d || Shards: %d || Processors: %d\n",
+		TEST_SIZE,NUM_OF_SHARDS,processorCount());
+	printf("%-10s%16s%10s%16s%10s\n","Threads","mutex ops/s","speedup",
+		"sharded ops/s","speedup");
+	for(n=1;n<=NUM_OF_THREADS;n=(n<NUM_OF_THREADS && 2*n>NUM_OF_THREADS) ? NUM_OF_THREADS : 2*n){
+		tree=newTree();
+		lock=newMutex();
+		locked=runIngest(NULL,tree,lock,n,TEST_SIZE,9000000);
+		freeTree(tree);
+		freeMutex(lock);
+		sharded=newShardedTree(NUM_OF_SHARDS,0,9000000);
+		split=runIngest(sharded,NULL,NULL,n,TEST_SIZE,9000000);
+		freeShardedTree(sharded);
+		if(n==1){
+			base[0]=locked;
+			base[1]=split;
+		}
+		printf("%-10d%16.0f%10.2f%16.0f%10.2f\n",n,locked,locked/base[0],
+			split,split/base[1]);
+	}
+
+	sharded=newShardedTree(NUM_OF_SHARDS,0,9000000);
+	tree=newTree();
+	for(i=0;i<TEST_SIZE;i++){
+		value=RandomInteger(0,90000);
+		shardedInsert(sharded,value);
+		treeInsert(tree,value);
+	}
+	printf("\nSkewed values in [0, 90000]\n");
+	printf("Largest shard before rebalancing: %lu\n",(unsigned long)shardedLargest(sharded));
+	start=wallClock();
+	shardedRebalance(sharded,1.5);
+	printf("Largest shard after rebalancing:  %lu (%.2f ms)\n",
+		(unsigned long)shardedLargest(sharded),1000*(wallClock()-start));
+	check.seen=0;
+	check.ordered=TRUE;
+	shardedForEach(sharded,checkOrder,&check);
+	if(!check.ordered || check.seen!=treeSize(tree))
+		Error("Sharded scan out of order!");
+	for(i=0;i<100;i++){
+		lo=RandomInteger(0,90000);
+		hi=lo+RandomInteger(0,20000);
+		if(shardedRangeCount(sharded,lo,hi)!=treeRangeCount(tree,lo,hi))
+			Error("Sharded range count is wrong!");
+	}
+	printf("Scan and range counts match one tree\n");
+	printf("Skewed ingest with %d threads: %.0f ops/s\n",NUM_OF_THREADS,
+		runIngest(sharded,NULL,NULL,NUM_OF_THREADS,TEST_SIZE,90000));
+	freeTree(tree);
+	freeShardedTree(sharded);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: runIngest
+ * -------------------
+ * Inserts size random values below range with n threads, into
+ * the sharded tree, or into the tree behind the lock if sharded
+ * is NULL, and returns the inserts per second.
+ */
+double runIngest(shardedADT sharded, treeADT tree, mutexADT lock,
+                 int n, int size, int range){
+	threadADT threads[MAX_THREADS];
+	ingestT work[MAX_THREADS];
+	double start;
+	int i;
+
+	start=wallClock();
+	for(i=0;i<n;i++){
+		work[i].sharded=sharded;
+		work[i].tree=tree;
+		work[i].lock=lock;
+		work[i].seed=i+1;
+		work[i].count=size/n+(i<size%n);
+		work[i].range=range;
+		threads[i]=newThread(ingestValues,&work[i]);
+	}
+	for(i=0;i<n;i++)
+		joinThread(threads[i]);
+	return (size/(wallClock()-start));
+}
+
+void ingestValues(void *arg){
+	ingestT *work=arg;
+	elementT value;
+	int i;
+
+	for(i=0;i<work->count;i++){
+		value=nextRandom(&work->seed)%work->range;
+		if(work->sharded!=NULL)
+			shardedInsert(work->sharded,value);
+		else {
+			lockMutex(work->lock);
+			treeInsert(work->tree,value);
+			unlockMutex(work->lock);
+		}
+	}
+}
+
+void checkOrder(elementT value, void *clientData){
+	orderCheckT *check=clientData;
+
+	if(check->seen>0 && value<check->last)
+		check->ordered=FALSE;
+	check->last=value;
+	check->seen++;
+}
+
+/*
+ * Function: lockFreeTest
+ * -------------------
+ * Runs an insert and delete heavy mix on a small key range
+ * from 1 up to the given number of threads, once on a tree
+ * with a mutex around every operation and once on the lock-free
+ * skip list, and prints the throughput and the median and 99th
+ * percentile latency of each. Then checks the contents of a
+ * skip list the most threads have worked on.
+ */
+void lockFreeTest(void){
+	skipListADT list;
+	skipHandleADT handle;
+	treeADT tree;
+	mutexADT lock;
+	double locked,lockFree,*latencies;
+	int i,n,samples,KEY_RANGE,NUM_OF_THREADS;
+
+	system("cls");
+	printf("Lock-Free Set Tester\n\n");
+	printf("Enter key range: ");
+	KEY_RANGE=GetInteger();
+	printf("Enter max number of threads (max: %d): ",MAX_THREADS);
+	NUM_OF_THREADS=GetInteger();
+	printf("\n");
+	if(KEY_RANGE<=0 || NUM_OF_THREADS<=0 || NUM_OF_THREADS>MAX_THREADS)
+		Error("I refuse!");
+
+	latencies=NewArray(MAX_THREADS*(CONTENDED_OPERATIONS/LATENCY_SAMPLE),double);
+	printf("Keys: %d || Operations per thread: %d || Processors: %d\n",
+		KEY_RANGE,CONTENDED_OPERATIONS,processorCount());
+	printf("40%% insert, 40%% delete, 15%% find, 5%% delete-min, latency in microseconds\n");
+	printf("%-9s%14s%8s%8s%14s%8s%8s\n","Threads","mutex ops/s","p50","p99",
+		"lock-free/s","p50","p99");
+	for(n=1;n<=NUM_OF_THREADS;n=(n<NUM_OF_THREADS && 2*n>NUM_OF_THREADS) ? NUM_OF_THREADS : 2*n){
+		samples=n*(CONTENDED_OPERATIONS/LATENCY_SAMPLE);
+		tree=newTree();
+		lock=newMutex();
+		list=newSkipList();
+		handle=newSkipHandle(list);
+		for(i=0;i<KEY_RANGE;i+=2){
+			treeInsert(tree,i);
+			skipInsert(handle,i);
+		}
+		freeSkipHandle(handle);
+		locked=runContended(NULL,tree,lock,n,KEY_RANGE,latencies);
+		qsort(latencies,samples,sizeof(double),compareLatencies);
+		printf("%-9d%14.0f%8.2f%8.2f",n,locked,1e6*latencies[samples/2],
+			1e6*latencies[samples-samples/100-1]);
+		lockFree=runContended(list,NULL,NULL,n,KEY_RANGE,latencies);
+		qsort(latencies,samples,sizeof(double),compareLatencies);
+		printf("%14.0f%8.2f%8.2f\n",lockFree,1e6*latencies[samples/2],
+			1e6*latencies[samples-samples/100-1]);
+		freeTree(tree);
+		freeMutex(lock);
+		freeSkipList(list);
+	}
+	FreeBlock(latencies);
+	checkLockFree(NUM_OF_THREADS,KEY_RANGE);
+	printf("\nContents check out with %d threads\n",NUM_OF_THREADS);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: runContended
+ * -------------------
+ * Runs n threads on the skip list, or on the tree behind the
+ * lock if list is NULL, and returns the operations per second
+ * of all threads together. Each thread stores its timed
+ * operations in its own part of latencies.
+ */
+double runContended(skipListADT list, treeADT tree, mutexADT lock,
+                    int n, int range, double *latencies){
+	threadADT threads[MAX_THREADS];
+	contendT work[MAX_THREADS];
+	double start;
+	int i;
+
+	start=wallClock();
+	for(i=0;i<n;i++){
+		work[i].list=list;
+		work[i].tree=tree;
+		work[i].lock=lock;
+		work[i].seed=i+1;
+		work[i].range=range;
+		work[i].latencies=latencies+i*(CONTENDED_OPERATIONS/LATENCY_SAMPLE);
+		threads[i]=newThread(list==NULL ? contendLocked : contendLockFree,&work[i]);
+	}
+	for(i=0;i<n;i++)
+		joinThread(threads[i]);
+	return ((double)CONTENDED_OPERATIONS*n/(wallClock()-start));
+}
+
+/*
+ * Functions: contendLocked, contendLockFree
+ * -------------------
+ * Pick each operation and key at random. The tree keeps
+ * duplicates, so it only inserts keys it doesn't have, to
+ * stay the same set as the skip list.
+ */
+void contendLocked(void *arg){
+	contendT *work=arg;
+	elementT value;
+	double start=0;
+	int i,choice;
+
+	for(i=0;i<CONTENDED_OPERATIONS;i++){
+		choice=nextRandom(&work->seed)%20;
+		value=nextRandom(&work->seed)%work->range;
+		if(i%LATENCY_SAMPLE==0)
+			start=wallClock();
+		lockMutex(work->lock);
+		if(choice<8){
+			if(findNode(work->tree,value)==NOT_FOUND)
+				treeInsert(work->tree,value);
+		} else if(choice<16)
+			treeDelete(work->tree,value);
+		else if(choice<19)
+			findNode(work->tree,value);
+		else if(treeSize(work->tree)>0)
+			treePopMin(work->tree);
+		unlockMutex(work->lock);
+		if(i%LATENCY_SAMPLE==0)
+			work->latencies[i/LATENCY_SAMPLE]=wallClock()-start;
+	}
+}
+
+void contendLockFree(void *arg){
+	contendT *work=arg;
+	skipHandleADT handle;
+	elementT value;
+	double start=0;
+	int i,choice;
+
+	handle=newSkipHandle(work->list);
+	for(i=0;i<CONTENDED_OPERATIONS;i++){
+		choice=nextRandom(&work->seed)%20;
+		value=nextRandom(&work->seed)%work->range;
+		if(i%LATENCY_SAMPLE==0)
+			start=wallClock();
+		if(choice<8)
+			skipInsert(handle,value);
+		else if(choice<16)
+			skipDelete(handle,value);
+		else if(choice<19)
+			skipFind(handle,value);
+		else
+			skipDeleteMin(handle);
+		if(i%LATENCY_SAMPLE==0)
+			work->latencies[i/LATENCY_SAMPLE]=wallClock()-start;
+	}
+	freeSkipHandle(handle);
+}
+
+/*
+ * Function: checkLockFree
+ * -------------------
+ * Runs n threads that each insert and delete keys of their
+ * own above range while inserting, deleting and looking up
+ * the keys below it, which all threads share. Then checks
+ * that each thread's keys are in the list exactly when it
+ * left them there and that the list's size adds up.
+ */
+void checkLockFree(int n, int range){
+	threadADT threads[MAX_THREADS];
+	ownedT work[MAX_THREADS];
+	skipListADT list;
+	skipHandleADT handle;
+	elementT key;
+	long expected=0;
+	int i,j;
+
+	list=newSkipList();
+	for(i=0;i<n;i++){
+		work[i].list=list;
+		work[i].seed=i+1;
+		work[i].id=i;
+		work[i].threads=n;
+		work[i].range=range;
+		work[i].owned=NewArray(OWNED_KEYS,bool);
+		for(j=0;j<OWNED_KEYS;j++)
+			work[i].owned[j]=FALSE;
+		work[i].net=0;
+		work[i].wrong=0;
+		threads[i]=newThread(churnOwned,&work[i]);
+	}
+	for(i=0;i<n;i++)
+		joinThread(threads[i]);
+	handle=newSkipHandle(list);
+	for(i=0;i<n;i++){
+		if(work[i].wrong>0)
+			Error("Skip list operation gave the wrong answer!");
+		for(j=0;j<OWNED_KEYS;j++){
+			key=range+i+j*n;
+			if((skipFind(handle,key)==key)!=(work[i].owned[j]==TRUE))
+				Error("Skip list lost a key!");
+			expected+=work[i].owned[j];
+		}
+		expected+=work[i].net;
+		FreeBlock(work[i].owned);
+	}
+	if(skipSize(handle)!=(size_t)expected)
+		Error("Skip list size is wrong!");
+	freeSkipHandle(handle);
+	freeSkipList(list);
+}
+
+/*
+ * Function: churnOwned
+ * -------------------
+ * Flips one of the thread's own keys every fourth operation,
+ * after checking that it is there exactly when expected, and
+ * else works on a random shared key. The thread's keys are
+ * interleaved with those of the other threads, so they share
+ * nodes on every level.
+ */
+void churnOwned(void *arg){
+	ownedT *work=arg;
+	skipHandleADT handle;
+	elementT key;
+	int i,j,choice;
+
+	handle=newSkipHandle(work->list);
+	for(i=0;i<CONTENDED_OPERATIONS;i++){
+		choice=nextRandom(&work->seed)%4;
+		if(choice==0){
+			j=nextRandom(&work->seed)%OWNED_KEYS;
+			key=work->range+work->id+j*work->threads;
+			if((skipFind(handle,key)==key)!=(work->owned[j]==TRUE))
+				work->wrong++;
+			if(work->owned[j] ? !skipDelete(handle,key) : !skipInsert(handle,key))
+				work->wrong++;
+			work->owned[j]=!work->owned[j];
+		} else {
+			key=nextRandom(&work->seed)%work->range;
+			if(choice==1)
+				work->net+=skipInsert(handle,key);
+			else if(choice==2)
+				work->net-=skipDelete(handle,key);
+			else
+				skipFind(handle,key);
+		}
+	}
+	freeSkipHandle(handle);
+}
+
+int compareLatencies(const void *a, const void *b){
+	double x=*(const double *)a,y=*(const double *)b;
+
+	return ((x>y)-(x<y));
+}
+
+/*
+ * Function: relaxedTest
+ * -------------------
+ * Times every insert of a burst of random values into a tree,
+ * once with eager rebalancing and once with relaxed balance,
+ * and prints the latency percentiles and heights. Then drains
+ * the relaxed tree's violations in steps and prints the
+ * longest step.
+ */
+void relaxedTest(void){
+	treeADT strict,relaxed;
+	elementT *keys;
+	double *latencies,total,start,longest;
+	size_t left;
+	int i,TEST_SIZE,BURST_SIZE,steps;
+
+	system("cls");
+	printf("Relaxed Balance Tester\n\n");
+	printf("Enter tree size: ");
+	TEST_SIZE=GetInteger();
+	printf("Enter burst size: ");
+	BURST_SIZE=GetInteger();
+	printf("\n");
+	if(TEST_SIZE<0 || BURST_SIZE<=0)
+		Error("I refuse!");
+
+	keys=NewArray(BURST_SIZE,elementT);
+	latencies=NewArray(BURST_SIZE,double);
+	strict=newTree();
+	relaxed=newTree();
+	for(i=0;i<TEST_SIZE;i++){
+		keys[0]=RandomInteger(0,9000000);
+		treeInsert(strict,keys[0]);
+		treeInsert(relaxed,keys[0]);
+	}
+	for(i=0;i<BURST_SIZE;i++)
+		keys[i]=RandomInteger(0,9000000);
+	treeRelaxBalance(relaxed,TRUE);
+	printf("Tree size: %d || Burst: %d random inserts, latency in nanoseconds\n",
+		TEST_SIZE,BURST_SIZE);
+	printf("%-10s%10s%10s%10s%10s%10s%10s\n","Balance","mean","p50","p99","p99.9",
+		"max","height");
+	total=timeBurst(strict,keys,BURST_SIZE,latencies);
+	printf("%-10s%10.0f%10.0f%10.0f%10.0f%10.0f%10d\n","eager",1e9*total/BURST_SIZE,
+		1e9*latencies[BURST_SIZE/2],1e9*latencies[BURST_SIZE-BURST_SIZE/100-1],
+		1e9*latencies[BURST_SIZE-BURST_SIZE/1000-1],1e9*latencies[BURST_SIZE-1],
+		treeHeight(strict));
+	total=timeBurst(relaxed,keys,BURST_SIZE,latencies);
+	printf("%-10s%10.0f%10.0f%10.0f%10.0f%10.0f%10d\n","relaxed",1e9*total/BURST_SIZE,
+		1e9*latencies[BURST_SIZE/2],1e9*latencies[BURST_SIZE-BURST_SIZE/100-1],
+		1e9*latencies[BURST_SIZE-BURST_SIZE/1000-1],1e9*latencies[BURST_SIZE-1],
+		treeHeight(relaxed));
+	printf("\nViolations left by the burst: %lu\n",(unsigned long)treeRebalanceStep(relaxed,0));
+	longest=0;
+	total=wallClock();
+	for(steps=0,left=1;left>0;steps++){
+		start=wallClock();
+		left=treeRebalanceStep(relaxed,1000);
+		if(wallClock()-start>longest)
+			longest=wallClock()-start;
+	}
+	total=wallClock()-total;
+	printf("Drained in %d steps of 1000, %.2f ms, longest step %.3f ms\n",
+		steps,1000*total,1000*longest);
+	printf("Height after draining: %d (eager tree: %d)\n",treeHeight(relaxed),
+		treeHeight(strict));
+	freeTree(strict);
+	freeTree(relaxed);
+	FreeBlock(keys);
+	FreeBlock(latencies);
+	printf("\nPress enter to return.");
+	getchar();
+}
+
+/*
+ * Function: timeBurst
+ * -------------------
+ * Inserts the keys one at a time, stores each insert's time
+ * in latencies, sorted, and returns the total time.
+ */
+double timeBurst(treeADT tree, elementT keys[], int n, double *latencies){
+	double start,total=0;
+	int i;
+
+	for(i=0;i<n;i++){
+		start=wallClock();
+		treeInsert(tree,keys[i]);
+		latencies[i]=wallClock()-start;
+		total+=latencies[i];
+	}
+	qsort(latencies,n,sizeof(double),compareLatencies);
+	return (total);
+}
+
+/*
+ * Functions: timeRedBlack, timeIntSet, ...
+ * -------------------
+ * Each of these inserts, finds and deletes the keys in one
+ * type of tree and prints the time per operation.
+ */
+void timeRedBlack(int *keys, int n){
+	treeADT tree=newTree();
+	double times[4];
+	int i;
+
+	times[0]=wallClock();
+	for(i=0;i<n;i++)
+		treeInsert(tree,keys[i]);
+	times[1]=wallClock();
+	for(i=0;i<n;i++)
+		if(findNode(tree,keys[i])!=keys[i])
+			Error("Lost key %d!",keys[i]);
+	times[2]=wallClock();
+	for(i=0;i<n;i++)
+		treeDelete(tree,keys[i]);
+	times[3]=wallClock();
+	freeTree(tree);
+	printTimes("treeADT (int)",times,n);
+}
+
+void timeIntSet(int *keys, int n){
+	intSetADT tree=intSetNew();
+	double times[4];
+	int i;
+
+	times[0]=wallClock();
+	for(i=0;i<n;i++)
+		intSetInsert(tree,keys[i]);
+	times[1]=wallClock();
+	for(i=0;i<n;i++)
+		if(!intSetFind(tree,keys[i]))
+			Error("Lost key %d!",keys[i]);
+	times[2]=wallClock();
+	for(i=0;i<n;i++)
+		intSetDelete(tree,keys[i]);
+	times[3]=wallClock();
+	intSetFree(tree);
+	printTimes("template (int)",times,n);
+}
+
+void timeLongMap(int *keys, int n){
+	longMapADT tree=longMapNew();
+	double times[4];
+	int i,value;
+
+	times[0]=wallClock();
+	for(i=0;i<n;i++)
+		longMapInsert(tree,(int64_t)keys[i]<<20,i);
+	times[1]=wallClock();
+	for(i=0;i<n;i++)
+		if(!longMapFind(tree,(int64_t)keys[i]<<20,&value) || keys[value]!=keys[i])
+			Error("Lost key %d!",keys[i]);
+	times[2]=wallClock();
+	for(i=0;i<n;i++)
+		longMapDelete(tree,(int64_t)keys[i]<<20);
+	times[3]=wallClock();
+	longMapFree(tree);
+	printTimes("template (int64_t, int)",times,n);
+}
+
+void timeRealMap(int *keys, int n){
+	realMapADT tree=realMapNew();
+	double times[4];
+	int i,value;
+
+	times[0]=wallClock();
+	for(i=0;i<n;i++)
+		realMapInsert(tree,keys[i]/3.0,i);
+	times[1]=wallClock();
+	for(i=0;i<n;i++)
+		if(!realMapFind(tree,keys[i]/3.0,&value) || keys[value]!=keys[i])
+			Error("Lost key %d!",keys[i]);
+	times[2]=wallClock();
+	for(i=0;i<n;i++)
+		realMapDelete(tree,keys[i]/3.0);
+	times[3]=wallClock();
+	realMapFree(tree);
+	printTimes("template (double, int)",times,n);
+}
+
+void timeVersionMap(int *keys, int n){
+	versionMapADT tree=versionMapNew();
+	versionT version;
+	double times[4];
+	int i,value;
+
+	times[0]=wallClock();
+	for(i=0;i<n;i++){
+		version.major=keys[i]/1000;
+		version.minor=keys[i]%1000;
+		versionMapInsert(tree,version,i);
+	}
+	times[1]=wallClock();
+	for(i=0;i<n;i++){
+		version.major=keys[i]/1000;
+		version.minor=keys[i]%1000;
+		if(!versionMapFind(tree,version,&value) || keys[value]!=keys[i])
+			Error("Lost key %d!",keys[i]);
+	}
+	times[2]=wallClock();
+	for(i=0;i<n;i++){
+		version.major=keys[i]/1000;
+		version.minor=keys[i]%1000;
+		versionMapDelete(tree,version);
+	}
+	times[3]=wallClock();
+	versionMapFree(tree);
+	printTimes("template (struct, int)",times,n);
+}
+
+/*
+ * Function: timeUpsert
+ * -------------------
+ * Compares insert-or-update done with a lookup followed by
+ * an insert against a single upsert.
+ */
+void timeUpsert(int *keys, int n){
+	longMapADT tree;
+	int *value;
+	double start,twoPass,onePass;
+	int i;
+
+	tree=longMapNew();
+	start=wallClock();
+	for(i=0;i<2*n;i++){
+		value=longMapFindPtr(tree,keys[i%n]);
+		if(value!=NULL)
+			*value=i;
+		else
+			longMapInsert(tree,keys[i%n],i);
+	}
+	twoPass=wallClock()-start;
+	longMapFree(tree);
+	tree=longMapNew();
+	start=wallClock();
+	for(i=0;i<2*n;i++)
+		longMapUpsert(tree,keys[i%n],i);
+	onePass=wallClock()-start;
+	longMapFree(tree);
+	printf("%-24s%10.0f\n","FindPtr + Insert",twoPass*1e9/(2*n));
+	printf("%-24s%10.0f\n","Upsert",onePass*1e9/(2*n));
+}
+
+void printTimes(string name, double times[], int n){
+	printf("%-24s%10.0f%10.0f%10.0f\n",name,(times[1]-times[0])*1e9/n,
+		(times[2]-times[1])*1e9/n,(times[3]-times[2])*1e9/n);
+}
+
+/*
+ * Function: churnTree
+ * -------------------
+ * Builds a private tree and then deletes and reinserts
+ * every key once before looking all of them up.
+ * RandomInteger is not used since rand() shares its
+ * state between threads.
+ */
+void churnTree(void *arg){
+	churnT *work=arg;
+	treeADT tree=newTree();
+	unsigned seed=work->seed;
+	int i;
+
+	for(i=0;i<work->size;i++)
+		treeInsert(tree,nextRandom(&seed));
+	seed=work->seed;
+	for(i=0;i<work->size;i++){
+		treeDelete(tree,nextRandom(&seed));
+		treeInsert(tree,i);
+	}
+	for(i=0;i<work->size;i++)
+		findNode(tree,i);
+	freeTree(tree);
+}
+
+int nextRandom(unsigned *seed){
+	*seed=*seed*1103515245+12345;
+	return ((int)(*seed>>8)%9000000);
+}
+
 treeADT buildTestTreeOrdered(int TEST_SIZE){
 	treeADT tree;
 	int i;
@@ -0,0 +1,476 @@
+/*
+ * File: persist.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the persist.h interface. Insert and
+ * delete are those of topdown.c, except that every node is
+ * made private to the new version before it is changed.
+ */
+
+#include "persist.h"
+#include "platform.h"
+#include "genlib.h"
+
+/*
+ * Type: nodeT
+ * ---------------------------
+ * refs holds the number of references to the node, from its
+ * parents and from versions, times REF, with the color in its
+ * lowest bit, so a node takes 24 bytes. The count is only
+ * changed by atomicAdd, since a version may be released by
+ * any thread. The color is only set on private nodes, which
+ * no other thread can see, and a count change never touches
+ * it, so readers may read it while other threads count.
+ */
+typedef struct nodeT {
+	elementT key;
+	volatile int32_t refs;
+	struct nodeT *child[2];
+} *nodeT;
+
+#define REF 2
+#define RED 1
+
+#define refsOf(n) ((n)->refs/REF)
+#define isRed(n) ((n)!=NULL && ((n)->refs&RED))
+#define setRed(n,red) ((n)->refs=((n)->refs&~RED)|(red))
+
+struct versionCDT {
+	nodeT root;
+	size_t size;
+	size_t copies;
+	volatile int32_t refs;
+};
+
+/*
+ * The writer mutex serializes the writers, lock only guards
+ * the current pointer while a snapshot takes its reference.
+ */
+struct liveTreeCDT {
+	versionADT current;
+	mutexADT writer;
+	mutexADT lock;
+};
+
+/* Private Function Prototypes */
+static versionADT newVersion(nodeT root, size_t size);
+static nodeT newNode(versionADT version, elementT value);
+static nodeT ownChild(versionADT version, nodeT x, int dir);
+static void retainNode(nodeT x);
+static void releaseNode(nodeT x);
+static nodeT rotate(versionADT version, nodeT x, int dir);
+static nodeT rotateTwice(versionADT version, nodeT x, int dir);
+static void publish(liveTreeADT live, versionADT newer);
+static void recRangeScan(nodeT x, elementT lo, elementT hi,
+                         scanFnT fn, void *clientData);
+static int checkSubtree(nodeT x);
+
+/******************* Exported entries **********************/
+
+versionADT emptyVersion(void){
+	return (newVersion(NULL,0));
+}
+
+versionADT versionRetain(versionADT version){
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	atomicAdd(&version->refs,1);
+	return (version);
+}
+
+void versionRelease(versionADT version){
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	if(atomicAdd(&version->refs,-1)==0){
+		releaseNode(version->root);
+		FreeBlock(version);
+	}
+}
+
+/*
+ * Implementation notes: versionInsert
+ * ---------------------------
+ * The walk is that of tdInsert. The new version starts out
+ * sharing the root, and every node the walk steps into, and
+ * every node a flip or rotation changes, is first made private
+ * by ownChild. The nodes copied this way are the path from the
+ * root down and a few of its neighbours.
+ */
+versionADT versionInsert(versionADT version, elementT value){
+	struct nodeT head;
+	versionADT newer;
+	nodeT t,g,p,q,z;
+	int dir=0,last=0,side;
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	newer=newVersion(version->root,version->size+1);
+	head.refs=REF;
+	head.child[0]=NULL;
+	head.child[1]=newer->root;
+	t=&head;
+	g=p=NULL;
+	q=ownChild(newer,&head,1);
+	z=NULL;
+	for(;;){
+		if(q==NULL){
+			q=z=newNode(newer,value);
+			if(p==NULL)
+				head.child[1]=q;
+			else
+				p->child[dir]=q;
+		}else if(isRed(q->child[0]) && isRed(q->child[1])){
+			setRed(q,RED);
+			setRed(ownChild(newer,q,0),0);
+			setRed(ownChild(newer,q,1),0);
+		}
+		if(isRed(q) && isRed(p)){
+			side=(t->child[1]==g);
+			if(q==p->child[last])
+				t->child[side]=rotate(newer,g,!last);
+			else
+				t->child[side]=rotateTwice(newer,g,!last);
+		}
+		if(q==z)
+			break;
+		last=dir;
+		dir=!(value < q->key);
+		if(g!=NULL)
+			t=g;
+		g=p;
+		p=q;
+		q=ownChild(newer,q,dir);
+	}
+	newer->root=head.child[1];
+	setRed(newer->root,0);
+	return (newer);
+}
+
+/*
+ * Implementation notes: versionDelete
+ * ---------------------------
+ * The walk is that of tdDelete, with the nodes made private
+ * as in versionInsert. The node removed at the bottom is
+ * private, so it is freed at once and its child moves up
+ * without changing its count.
+ */
+versionADT versionDelete(versionADT version, elementT value){
+	struct nodeT head;
+	versionADT newer;
+	nodeT g,p,q,s,f,top;
+	int dir,last,side;
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	newer=newVersion(version->root,version->size);
+	if(newer->root==NULL)
+		return (newer);
+	head.refs=REF;
+	head.child[0]=NULL;
+	head.child[1]=newer->root;
+	q=&head;
+	g=p=f=NULL;
+	dir=1;
+	while(q->child[dir]!=NULL){
+		last=dir;
+		g=p;
+		p=q;
+		q=ownChild(newer,q,dir);
+		dir=(q->key < value);
+		if(!dir && !(value < q->key))
+			f=q;
+		if(!isRed(q) && !isRed(q->child[dir])){
+			if(isRed(q->child[!dir])){
+				p=p->child[last]=rotate(newer,q,dir);
+			}else if((s=ownChild(newer,p,!last))!=NULL){
+				if(!isRed(s->child[0]) && !isRed(s->child[1])){
+					setRed(p,0);
+					setRed(s,RED);
+					setRed(q,RED);
+				}else{
+					side=(g->child[1]==p);
+					if(isRed(s->child[last]))
+						top=g->child[side]=rotateTwice(newer,p,last);
+					else
+						top=g->child[side]=rotate(newer,p,last);
+					setRed(q,RED);
+					setRed(top,RED);
+					setRed(ownChild(newer,top,0),0);
+					setRed(ownChild(newer,top,1),0);
+				}
+			}
+		}
+	}
+	if(f!=NULL){
+		f->key=q->key;
+		p->child[p->child[1]==q]=q->child[q->child[0]==NULL];
+		FreeBlock(q);
+		newer->size--;
+	}
+	newer->root=head.child[1];
+	if(newer->root!=NULL)
+		setRed(newer->root,0);
+	return (newer);
+}
+
+elementT versionFind(versionADT version, elementT value){
+	nodeT x;
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	x=version->root;
+	while(x!=NULL){
+		if(value < x->key)
+			x=x->child[0];
+		else if(value > x->key)
+			x=x->child[1];
+		else /* (value == x->key) */
+			return (x->key);
+	}
+	return (NOT_FOUND);
+}
+
+void versionRangeScan(versionADT version, elementT lo, elementT hi,
+                      scanFnT fn, void *clientData){
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	recRangeScan(version->root,lo,hi,fn,clientData);
+}
+
+size_t versionSize(versionADT version){
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	return (version->size);
+}
+
+int versionBlackHeight(versionADT version){
+	int bHeight;
+
+	if(version==NULL)
+		Error("Version not initialized!");
+	if(version->root==NULL) return 0;
+	if(isRed(version->root)) return -1;
+	bHeight=checkSubtree(version->root);
+	return (bHeight<0 ? -1 : bHeight-1);
+}
+
+size_t versionCopies(versionADT version){
+	return (version->copies);
+}
+
+liveTreeADT newLiveTree(void){
+	liveTreeADT live;
+
+	live=New(liveTreeADT);
+	live->current=emptyVersion();
+	live->writer=newMutex();
+	live->lock=newMutex();
+	return (live);
+}
+
+void freeLiveTree(liveTreeADT live){
+
+	if(live==NULL)
+		Error("Tree not initialized!");
+	versionRelease(live->current);
+	freeMutex(live->writer);
+	freeMutex(live->lock);
+	FreeBlock(live);
+}
+
+versionADT liveSnapshot(liveTreeADT live){
+	versionADT snapshot;
+
+	lockMutex(live->lock);
+	snapshot=versionRetain(live->current);
+	unlockMutex(live->lock);
+	return (snapshot);
+}
+
+void liveInsert(liveTreeADT live, elementT value){
+
+	lockMutex(live->writer);
+	publish(live,versionInsert(live->current,value));
+	unlockMutex(live->writer);
+}
+
+bool liveDelete(liveTreeADT live, elementT value){
+	versionADT newer;
+	bool found;
+
+	lockMutex(live->writer);
+	newer=versionDelete(live->current,value);
+	found=(newer->size<live->current->size);
+	publish(live,newer);
+	unlockMutex(live->writer);
+	return (found);
+}
+
+/**************** End of exported entries *******************/
+
+/*
+ * Function: newVersion
+ * ---------------------------
+ * Returns a version with one reference that shares root.
+ */
+static versionADT newVersion(nodeT root, size_t size){
+	versionADT version;
+
+	version=New(versionADT);
+	version->root=root;
+	retainNode(root);
+	version->size=size;
+	version->copies=0;
+	version->refs=1;
+	return (version);
+}
+
+/*
+ * Implementation notes: newNode
+ * ---------------------------
+ * Nodes are taken with GetBlock rather than from an arena,
+ * because a node is freed by whichever thread releases the
+ * last version that uses it.
+ */
+static nodeT newNode(versionADT version, elementT value){
+	nodeT node;
+
+	node=New(nodeT);
+	node->key=value;
+	node->refs=REF|RED;
+	node->child[0]=node->child[1]=NULL;
+	version->copies++;
+	return (node);
+}
+
+/*
+ * Function: ownChild
+ * ---------------------------
+ * Makes child dir of x private to the version being made and
+ * returns it. x must be private already. A child with a count
+ * of one is then only reachable through x and is returned as
+ * it is. Otherwise it is shared with older versions, and is
+ * replaced by a copy that shares its children in turn.
+ */
+static nodeT ownChild(versionADT version, nodeT x, int dir){
+	nodeT c=x->child[dir],copy;
+
+	if(c==NULL || refsOf(c)==1)
+		return (c);
+	copy=New(nodeT);
+	copy->key=c->key;
+	copy->refs=REF|(c->refs&RED);
+	copy->child[0]=c->child[0];
+	copy->child[1]=c->child[1];
+	retainNode(copy->child[0]);
+	retainNode(copy->child[1]);
+	x->child[dir]=copy;
+	releaseNode(c);
+	version->copies++;
+	return (copy);
+}
+
+static void retainNode(nodeT x){
+
+	if(x!=NULL)
+		atomicAdd(&x->refs,REF);
+}
+
+/*
+ * Function: releaseNode
+ * ---------------------------
+ * Drops a reference to x and frees it if that was the last,
+ * which drops the references it held on its children. The
+ * right child is handled by the loop, so the recursion is
+ * no deeper than the tree.
+ */
+static void releaseNode(nodeT x){
+	nodeT next;
+
+	while(x!=NULL && atomicAdd(&x->refs,-REF)<REF){
+		releaseNode(x->child[0]);
+		next=x->child[1];
+		FreeBlock(x);
+		x=next;
+	}
+}
+
+/*
+ * Functions: rotate, rotateTwice
+ * ---------------------------
+ * As in topdown.c, with the child that moves up made private
+ * first. x must be private.
+ */
+static nodeT rotate(versionADT version, nodeT x, int dir){
+	nodeT y=ownChild(version,x,!dir);
+
+	x->child[!dir]=y->child[dir];
+	y->child[dir]=x;
+	setRed(x,RED);
+	setRed(y,0);
+	return (y);
+}
+
+static nodeT rotateTwice(versionADT version, nodeT x, int dir){
+
+	x->child[!dir]=rotate(version,ownChild(version,x,!dir),!dir);
+	return (rotate(version,x,dir));
+}
+
+/*
+ * Function: publish
+ * ---------------------------
+ * Makes newer the current version and releases the old one,
+ * outside the lock. Snapshots still holding the old version
+ * keep its nodes alive.
+ */
+static void publish(liveTreeADT live, versionADT newer){
+	versionADT old;
+
+	lockMutex(live->lock);
+	old=live->current;
+	live->current=newer;
+	unlockMutex(live->lock);
+	versionRelease(old);
+}
+
+static void recRangeScan(nodeT x, elementT lo, elementT hi,
+                         scanFnT fn, void *clientData){
+	while(x!=NULL){
+		if(x->key < lo){
+			x=x->child[1];
+		}else{
+			recRangeScan(x->child[0],lo,hi,fn,clientData);
+			if(!(x->key < hi))
+				return;
+			fn(x->key,clientData);
+			x=x->child[1];
+		}
+	}
+}
+
+/*
+ * Function: checkSubtree
+ * ---------------------------
+ * As in topdown.c: the number of black nodes on every path
+ * from x down to a leaf, or -1 if a property is broken.
+ */
+static int checkSubtree(nodeT x){
+	int lh,rh;
+
+	if(x==NULL) return 0;
+	if(isRed(x) && (isRed(x->child[0]) || isRed(x->child[1])))
+		return (-1);
+	if((x->child[0]!=NULL && x->key < x->child[0]->key) ||
+	   (x->child[1]!=NULL && x->child[1]->key < x->key))
+		return (-1);
+	lh=checkSubtree(x->child[0]);
+	rh=checkSubtree(x->child[1]);
+	if(lh<0 || lh!=rh)
+		return (-1);
+	return (lh+!isRed(x));
+}
@@ -0,0 +1,197 @@
+/*
+ * File: persist.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports persistent red-black trees. A version of
+ * the tree never changes once it is made: an insert or delete
+ * copies only the O(log n) nodes on the path it touches and
+ * returns a new version that shares all other nodes with the
+ * old one. Versions and nodes are reference counted, so a
+ * version is kept alive by taking a reference in O(1) and
+ * its nodes are freed when the last version using them is
+ * released.
+ *
+ * On top of the versions, a live tree keeps the current
+ * version of a tree that one writer at a time changes, while
+ * any number of readers take snapshots of it and search them
+ * without locks, each seeing the tree as it was when the
+ * snapshot was taken.
+ *
+ * Rebalancing is done top-down as in topdown.h, so the nodes
+ * need no parent pointers, which path copying can't keep.
+ */
+
+#ifndef _persist_h
+#define _persist_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Type: versionADT
+ * --------------------------
+ * The type versionADT points to one version of a persistent
+ * tree. Every function that returns a version gives the caller
+ * a reference that must be released with versionRelease.
+ */
+
+typedef struct versionCDT *versionADT;
+
+/*
+ * Function: emptyVersion
+ * Usage: version = emptyVersion();
+ * --------------------------
+ * This function returns a version with no values.
+ */
+
+versionADT emptyVersion(void);
+
+/*
+ * Function: versionRetain
+ * Usage: snapshot = versionRetain(version);
+ * --------------------------
+ * This function takes one more reference to the version and
+ * returns it, in O(1).
+ */
+
+versionADT versionRetain(versionADT version);
+
+/*
+ * Function: versionRelease
+ * Usage: versionRelease(version);
+ * -------------------------------
+ * This procedure gives back a reference to the version. When
+ * the last one is gone, the version and every node no other
+ * version uses are freed. Any thread may release a version.
+ */
+
+void versionRelease(versionADT version);
+
+/*
+ * Function: versionInsert
+ * Usage: newer = versionInsert(version, value);
+ * -------------------------------
+ * This function returns a new version holding the values of
+ * version and one more value. Equal values are kept, after
+ * those already there. The old version doesn't change.
+ */
+
+versionADT versionInsert(versionADT version, elementT value);
+
+/*
+ * Function: versionDelete
+ * Usage: newer = versionDelete(version, value);
+ * -------------------------------
+ * This function returns a new version without one occurrence
+ * of the value. If the value doesn't exist, the new version
+ * holds the same values. The old version doesn't change.
+ */
+
+versionADT versionDelete(versionADT version, elementT value);
+
+/*
+ * Function: versionFind
+ * Usage: value=versionFind(version, value);
+ * -------------------------------
+ * This function is used to find a value in the version.
+ * If the value doesn't exist the function returns the
+ * constant NOT_FOUND.
+ */
+
+elementT versionFind(versionADT version, elementT value);
+
+/*
+ * Function: versionRangeScan
+ * Usage: versionRangeScan(version, lo, hi, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * v with lo <= v < hi, in increasing order, like treeRangeScan.
+ */
+
+void versionRangeScan(versionADT version, elementT lo, elementT hi,
+                      scanFnT fn, void *clientData);
+
+/*
+ * Function: versionSize
+ * Usage: n=versionSize(version);
+ * -------------------------------
+ * This function returns the number of values in the version.
+ */
+
+size_t versionSize(versionADT version);
+
+/*
+ * Function: versionBlackHeight
+ * Usage: bHeight=versionBlackHeight(version);
+ * -------------------------------
+ * This function checks the red-black properties of the
+ * version and returns its black height, counted like
+ * blackHeight does, or -1 if a property is broken.
+ */
+
+int versionBlackHeight(versionADT version);
+
+/*
+ * Function: versionCopies
+ * Usage: n=versionCopies(version);
+ * -------------------------------
+ * This function returns the number of nodes that were copied
+ * or allocated to make the version from the one it came from,
+ * which is the write amplification of that change.
+ */
+
+size_t versionCopies(versionADT version);
+
+/*
+ * Type: liveTreeADT
+ * --------------------------
+ * The type liveTreeADT points to the live tree's concrete type.
+ */
+
+typedef struct liveTreeCDT *liveTreeADT;
+
+/*
+ * Function: newLiveTree
+ * Usage: live = newLiveTree();
+ * --------------------------
+ * This function allocates and returns an empty live tree.
+ */
+
+liveTreeADT newLiveTree(void);
+
+/*
+ * Function: freeLiveTree
+ * Usage: freeLiveTree(live);
+ * -------------------------------
+ * This procedure frees the live tree and releases its current
+ * version. Snapshots taken from it stay valid.
+ */
+
+void freeLiveTree(liveTreeADT live);
+
+/*
+ * Function: liveSnapshot
+ * Usage: snapshot = liveSnapshot(live);
+ * -------------------------------
+ * This function returns a reference to the current version in
+ * O(1). Searching it needs no locks and is never disturbed by
+ * the writer. The caller releases it with versionRelease.
+ */
+
+versionADT liveSnapshot(liveTreeADT live);
+
+/*
+ * Functions: liveInsert, liveDelete
+ * Usage: liveInsert(live, value); if(liveDelete(live, value)) ...
+ * -------------------------------
+ * These make a new version with versionInsert or versionDelete
+ * and make it the current one. liveDelete returns FALSE if the
+ * value didn't exist. Writers are serialized, but never wait
+ * for readers.
+ */
+
+void liveInsert(liveTreeADT live, elementT value);
+bool liveDelete(liveTreeADT live, elementT value);
+
+#endif
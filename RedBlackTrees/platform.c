@@ -0,0 +1,210 @@
+/*
+ * File: platform.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the platform.h interface for
+ * Windows and POSIX systems.
+ */
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  define _POSIX_C_SOURCE 200112L
+#  include <pthread.h>
+#  include <sched.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86)
+#  include <intrin.h>
+#  define HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define HAS_RDTSC
+#endif
+#include "platform.h"
+#include "genlib.h"
+
+struct threadCDT {
+	threadFnT fn;
+	void *arg;
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+};
+
+/*
+ * A mutex is padded by a cache line, so that two mutexes
+ * never share one and threads taking different locks don't
+ * slow each other down.
+ */
+struct mutexCDT {
+#ifdef _WIN32
+	CRITICAL_SECTION lock;
+#else
+	pthread_mutex_t lock;
+#endif
+	char padding[64];
+};
+
+/* Private Function Prototypes */
+#ifdef _WIN32
+static DWORD WINAPI threadStart(LPVOID arg);
+#else
+static void *threadStart(void *arg);
+#endif
+
+/******************* Exported entries **********************/
+
+threadADT newThread(threadFnT fn, void *arg){
+	threadADT thread;
+
+	thread=New(threadADT);
+	thread->fn=fn;
+	thread->arg=arg;
+#ifdef _WIN32
+	thread->handle=CreateThread(NULL,0,threadStart,thread,0,NULL);
+	if(thread->handle==NULL)
+		Error("Could not start thread!");
+#else
+	if(pthread_create(&thread->handle,NULL,threadStart,thread)!=0)
+		Error("Could not start thread!");
+#endif
+	return (thread);
+}
+
+void joinThread(threadADT thread){
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle,INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle,NULL);
+#endif
+	FreeBlock(thread);
+}
+
+mutexADT newMutex(void){
+	mutexADT mutex;
+
+	mutex=New(mutexADT);
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->lock);
+#else
+	if(pthread_mutex_init(&mutex->lock,NULL)!=0)
+		Error("Could not create mutex!");
+#endif
+	return (mutex);
+}
+
+void freeMutex(mutexADT mutex){
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_destroy(&mutex->lock);
+#endif
+	FreeBlock(mutex);
+}
+
+void lockMutex(mutexADT mutex){
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void unlockMutex(mutexADT mutex){
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+int32_t atomicAdd(volatile int32_t *counter, int32_t delta){
+#ifdef _WIN32
+	return (InterlockedExchangeAdd((volatile LONG *)counter,delta)+delta);
+#else
+	return (__sync_add_and_fetch(counter,delta));
+#endif
+}
+
+bool atomicCompareSwap(volatile int32_t *target, int32_t expected, int32_t desired){
+#ifdef _WIN32
+	return (InterlockedCompareExchange((volatile LONG *)target,desired,expected)==expected);
+#else
+	return (__sync_bool_compare_and_swap(target,expected,desired));
+#endif
+}
+
+bool atomicCompareSwapPointer(void *volatile *target, void *expected, void *desired){
+#ifdef _WIN32
+	return (InterlockedCompareExchangePointer(target,desired,expected)==expected);
+#else
+	return (__sync_bool_compare_and_swap(target,expected,desired));
+#endif
+}
+
+void yieldThread(void){
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+int processorCount(void){
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return ((int)info.dwNumberOfProcessors);
+#else
+	long n=sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n>0 ? (int)n : 1);
+#endif
+}
+
+double wallClock(void){
+#ifdef _WIN32
+	LARGE_INTEGER count,frequency;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return ((double)count.QuadPart/(double)frequency.QuadPart);
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (now.tv_sec+now.tv_nsec*1e-9);
+#endif
+}
+
+uint64_t cycleCount(void){
+#ifdef HAS_RDTSC
+	return (__rdtsc());
+#else
+	return ((uint64_t)(wallClock()*1e9));
+#endif
+}
+
+/**************** End of exported entries *******************/
+
+#ifdef _WIN32
+static DWORD WINAPI threadStart(LPVOID arg){
+	threadADT thread=arg;
+
+	thread->fn(thread->arg);
+	return (0);
+}
+#else
+static void *threadStart(void *arg){
+	threadADT thread=arg;
+
+	thread->fn(thread->arg);
+	return (NULL);
+}
+#endif
@@ -0,0 +1,199 @@
+/*
+ * File: platform.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file hides the differences between Windows and
+ * POSIX systems for the few services the trees and tests
+ * need: threads, locks, atomic counters, the processor count
+ * and a wall clock.
+ */
+
+#ifndef _platform_h
+#define _platform_h
+
+#include <stdint.h>
+#include "genlib.h"
+
+/*
+ * Type: threadADT
+ * --------------------------
+ * The type threadADT points to a running thread.
+ */
+
+typedef struct threadCDT *threadADT;
+
+/*
+ * Type: threadFnT
+ * --------------------------
+ * The type of a function that is run by a thread.
+ */
+
+typedef void (*threadFnT)(void *arg);
+
+/*
+ * Function: newThread
+ * Usage: thread = newThread(fn, arg);
+ * --------------------------
+ * This function starts a new thread calling fn(arg).
+ */
+
+threadADT newThread(threadFnT fn, void *arg);
+
+/*
+ * Function: joinThread
+ * Usage: joinThread(thread);
+ * -------------------------------
+ * This procedure waits for the thread to finish and
+ * frees its storage.
+ */
+
+void joinThread(threadADT thread);
+
+/*
+ * Type: mutexADT
+ * --------------------------
+ * The type mutexADT points to a lock that one thread at a
+ * time can hold.
+ */
+
+typedef struct mutexCDT *mutexADT;
+
+/*
+ * Function: newMutex
+ * Usage: mutex = newMutex();
+ * --------------------------
+ * This function allocates and returns an unlocked mutex.
+ */
+
+mutexADT newMutex(void);
+
+/*
+ * Function: freeMutex
+ * Usage: freeMutex(mutex);
+ * -------------------------------
+ * This procedure frees an unlocked mutex.
+ */
+
+void freeMutex(mutexADT mutex);
+
+/*
+ * Functions: lockMutex, unlockMutex
+ * Usage: lockMutex(mutex); ... unlockMutex(mutex);
+ * -------------------------------
+ * lockMutex waits until no other thread holds the mutex and
+ * takes it, unlockMutex gives it back.
+ */
+
+void lockMutex(mutexADT mutex);
+void unlockMutex(mutexADT mutex);
+
+/*
+ * Function: atomicAdd
+ * Usage: n = atomicAdd(&counter, 1);
+ * -------------------------------
+ * This function adds delta to the counter as one indivisible
+ * step, even when other threads change it at the same time,
+ * and returns the new value. It is also a full memory barrier.
+ */
+
+int32_t atomicAdd(volatile int32_t *counter, int32_t delta);
+
+/*
+ * Functions: atomicCompareSwap, atomicCompareSwapPointer
+ * Usage: if(atomicCompareSwapPointer(&node->next, old, new)) ...
+ * -------------------------------
+ * These store desired in target if it still holds expected,
+ * as one indivisible step, and return TRUE if they did. They
+ * are also full memory barriers.
+ */
+
+bool atomicCompareSwap(volatile int32_t *target, int32_t expected, int32_t desired);
+bool atomicCompareSwapPointer(void *volatile *target, void *expected, void *desired);
+
+/*
+ * Macros: acquireFence, releaseFence, memoryFence
+ * Usage: acquireFence();
+ * -------------------------------
+ * These keep the processor and the compiler from moving
+ * memory accesses across them. acquireFence keeps the loads
+ * before it ahead of every access after it, releaseFence
+ * keeps every access before it ahead of the stores after it,
+ * and memoryFence also keeps stores before it ahead of loads
+ * after it. Only memoryFence costs an instruction on x86.
+ */
+
+#if defined(__GNUC__)
+#  define acquireFence() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#  define releaseFence() __atomic_thread_fence(__ATOMIC_RELEASE)
+#  define memoryFence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(_M_X64) || defined(_M_IX86)
+#  include <intrin.h>
+#  define acquireFence() _ReadWriteBarrier()
+#  define releaseFence() _ReadWriteBarrier()
+#  define memoryFence() _mm_mfence()
+#else
+#  error "No memory fences for this compiler"
+#endif
+
+/*
+ * Function: yieldThread
+ * Usage: yieldThread();
+ * -------------------------------
+ * This procedure lets other threads run before the calling
+ * thread goes on, for threads that wait for another thread.
+ */
+
+void yieldThread(void);
+
+/*
+ * Function: processorCount
+ * Usage: n = processorCount();
+ * -------------------------------
+ * This function returns the number of processors the
+ * program can run on, at least 1.
+ */
+
+int processorCount(void);
+
+/*
+ * Function: wallClock
+ * Usage: start = wallClock();
+ * -------------------------------
+ * This function returns the elapsed real time in seconds
+ * since some fixed point. Unlike clock() it keeps counting
+ * while a thread waits and doesn't add up several threads.
+ */
+
+double wallClock(void);
+
+/*
+ * Macro: prefetch
+ * Usage: prefetch(ptr);
+ * -------------------------------
+ * This macro asks the processor to start loading the cache
+ * line at ptr and returns at once, so the load overlaps with
+ * other work. ptr may be any address, it is never dereferenced.
+ * Compilers without a prefetch builtin ignore it.
+ */
+
+#if defined(__GNUC__)
+#  define prefetch(ptr) __builtin_prefetch(ptr)
+#elif defined(_M_X64) || defined(_M_IX86)
+#  include <xmmintrin.h>
+#  define prefetch(ptr) _mm_prefetch((const char *)(ptr),_MM_HINT_T0)
+#else
+#  define prefetch(ptr) ((void)0)
+#endif
+
+/*
+ * Function: cycleCount
+ * Usage: start = cycleCount();
+ * -------------------------------
+ * This function returns the processor's time stamp counter,
+ * which on current x86 processors ticks at the nominal clock
+ * rate. On other processors it returns nanoseconds instead.
+ */
+
+uint64_t cycleCount(void);
+
+#endif
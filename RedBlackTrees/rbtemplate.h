@@ -0,0 +1,555 @@
+/*
+ * File: rbtemplate.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file is a template for red-black trees over any key
+ * type, optionally with a value attached to every key. The
+ * key type, value type and comparison are fixed when the
+ * template is instantiated, so the comparison is compiled
+ * straight into the search loops instead of being called
+ * through a function pointer.
+ *
+ * Instantiate it by defining the parameters and including
+ * the file, once per tree type:
+ *
+ *    #define RBT_PREFIX  priceMap
+ *    #define RBT_KEY     int64_t
+ *    #define RBT_VALUE   double
+ *    #include "rbtemplate.h"
+ *
+ * Parameters:
+ *    RBT_PREFIX        -- Prefix of every type and function name
+ *    RBT_KEY           -- The key type
+ *    RBT_VALUE         -- The value type, leave it undefined for
+ *                         a tree of keys only
+ *    RBT_COMPARE(a,b)  -- Returns <0, 0 or >0 like strcmp. The
+ *                         default uses the < and > operators.
+ *    RBT_UNIQUE        -- Define to give the tree set semantics,
+ *                         Insert then refuses keys already there.
+ *
+ * This defines the type priceMapADT and the functions
+ * priceMapNew, priceMapFree, priceMapInsert, priceMapDelete,
+ * priceMapFind, priceMapFindPtr, priceMapSize and, for trees
+ * with values, priceMapUpsert. All of them are static inline,
+ * so every source file that uses a tree type instantiates it,
+ * and the ones it doesn't call cost nothing.
+ * The parameters are undefined again at the end of the file.
+ */
+
+#include <stdint.h>
+#include "genlib.h"
+#include "arena.h"
+
+#ifndef RBT_PREFIX
+#  error "RBT_PREFIX must be defined before including rbtemplate.h"
+#endif
+#ifndef RBT_KEY
+#  error "RBT_KEY must be defined before including rbtemplate.h"
+#endif
+#ifndef RBT_COMPARE
+#  define RBT_COMPARE(a,b) ((a)<(b) ? -1 : (a)>(b))
+#endif
+
+/*
+ * Private macros
+ * --------------------------
+ * These are shared by all instantiations. They refer to
+ * RBT_PREFIX only when expanded, so they always name the
+ * types of the instantiation that uses them.
+ */
+
+#ifndef _rbtemplate_h
+#define _rbtemplate_h
+
+#define RBT_PASTE(a,b) a##b
+#define RBT_JOIN(a,b) RBT_PASTE(a,b)
+#define RBT_FN(name) RBT_JOIN(RBT_PREFIX,name)
+#define RBT_ADT RBT_FN(ADT)
+#define RBT_NODE RBT_FN(NodeT)
+#define RBT_NIL (&RBT_FN(NilNode))
+
+/*
+ * RBT_API makes the exported functions static inline, so the
+ * compiler doesn't warn about those an instantiation never
+ * calls.
+ */
+#if defined(__GNUC__)
+#  define RBT_API static __inline__
+#elif defined(_MSC_VER)
+#  define RBT_API static __inline
+#else
+#  define RBT_API static
+#endif
+
+/*
+ * The colors are chosen so that a zero-initialized node
+ * is black, which lets the static sentinel be set up
+ * without an initializer naming the key type.
+ */
+#define RBT_BLACK 0
+#define RBT_RED 1
+
+#define rbtParentOf(n) ((RBT_NODE)((n)->parentColor&~(uintptr_t)1))
+#define rbtColorOf(n) ((int)((n)->parentColor&1))
+#define rbtSetParent(n,p) ((n)->parentColor=(uintptr_t)(p)|((n)->parentColor&1))
+#define rbtSetColor(n,c) ((n)->parentColor=((n)->parentColor&~(uintptr_t)1)|(c))
+
+#endif
+
+#ifdef RBT_VALUE
+#  define RBT_VALUE_PARAM , RBT_VALUE value
+#  define RBT_VALUE_ARG , value
+#  define RBT_VALUE_OUT , RBT_VALUE *value
+#  define RBT_FOUND_T RBT_VALUE
+#else
+#  define RBT_VALUE_PARAM
+#  define RBT_VALUE_ARG
+#  define RBT_VALUE_OUT
+#  define RBT_FOUND_T const RBT_KEY
+#endif
+
+typedef struct RBT_FN(CDT) *RBT_ADT;
+
+typedef struct RBT_FN(NodeT) {
+	RBT_KEY key;
+#ifdef RBT_VALUE
+	RBT_VALUE value;
+#endif
+	struct RBT_FN(NodeT) *left,*right;
+	uintptr_t parentColor;
+} *RBT_NODE;
+
+struct RBT_FN(CDT) {
+	RBT_NODE root;
+	size_t size;
+	arenaADT arena;
+};
+
+/*
+ * The sentinel of this instantiation. It is black,
+ * has no parent and is never written to.
+ */
+static struct RBT_FN(NodeT) RBT_FN(NilNode);
+
+/* Private Function Prototypes */
+static void RBT_FN(InsertAt)(RBT_ADT tree, RBT_NODE y, int cmp, RBT_KEY key RBT_VALUE_PARAM);
+static void RBT_FN(InsertFixup)(RBT_ADT tree, RBT_NODE z);
+static void RBT_FN(DeleteFixup)(RBT_ADT tree, RBT_NODE x, RBT_NODE xParent);
+static void RBT_FN(LeftRotate)(RBT_ADT tree, RBT_NODE x);
+static void RBT_FN(RightRotate)(RBT_ADT tree, RBT_NODE y);
+static void RBT_FN(Transplant)(RBT_ADT tree, RBT_NODE u, RBT_NODE v);
+
+/*
+ * Function: <prefix>New
+ * Usage: tree = <prefix>New();
+ * --------------------------
+ * This function allocates and returns an empty tree.
+ */
+
+RBT_API RBT_ADT RBT_FN(New)(void){
+	RBT_ADT tree;
+
+	tree=New(RBT_ADT);
+	tree->root=RBT_NIL;
+	tree->size=0;
+	tree->arena=newArena(sizeof(struct RBT_FN(NodeT)));
+	return (tree);
+}
+
+/*
+ * Function: <prefix>Free
+ * Usage: <prefix>Free(tree);
+ * --------------------------
+ * This procedure frees the storage associated with the tree.
+ */
+
+RBT_API void RBT_FN(Free)(RBT_ADT tree){
+	freeArena(tree->arena);
+	FreeBlock(tree);
+}
+
+/*
+ * Function: <prefix>Size
+ * Usage: n = <prefix>Size(tree);
+ * --------------------------
+ * This function returns the number of keys in the tree.
+ */
+
+RBT_API size_t RBT_FN(Size)(RBT_ADT tree){
+	return (tree->size);
+}
+
+/*
+ * Function: <prefix>Find
+ * Usage: if(<prefix>Find(tree, key[, &value])) ...
+ * --------------------------
+ * This function returns TRUE if the key is in the tree.
+ * For trees with values the value of the key is copied
+ * to *value, unless value is NULL.
+ */
+
+RBT_API bool RBT_FN(Find)(RBT_ADT tree, RBT_KEY key RBT_VALUE_OUT){
+	RBT_NODE x=tree->root;
+	int cmp;
+
+	while(x!=RBT_NIL){
+		cmp=RBT_COMPARE(key,x->key);
+		if(cmp<0)
+			x=x->left;
+		else if(cmp>0)
+			x=x->right;
+		else {
+#ifdef RBT_VALUE
+			if(value!=NULL)
+				*value=x->value;
+#endif
+			return (TRUE);
+		}
+	}
+	return (FALSE);
+}
+
+/*
+ * Function: <prefix>FindPtr
+ * Usage: ptr = <prefix>FindPtr(tree, key);
+ * --------------------------
+ * This function returns a pointer to the value stored with
+ * the key, or to the stored key itself for trees without
+ * values. It returns NULL if the key isn't in the tree, so
+ * every key and value can be told apart from a miss. The
+ * value may be changed through the pointer, which stays
+ * valid until the key is deleted.
+ */
+
+RBT_API RBT_FOUND_T *RBT_FN(FindPtr)(RBT_ADT tree, RBT_KEY key){
+	RBT_NODE x=tree->root;
+	int cmp;
+
+	while(x!=RBT_NIL){
+		cmp=RBT_COMPARE(key,x->key);
+		if(cmp<0)
+			x=x->left;
+		else if(cmp>0)
+			x=x->right;
+		else
+#ifdef RBT_VALUE
+			return (&x->value);
+#else
+			return (&x->key);
+#endif
+	}
+	return (NULL);
+}
+
+/*
+ * Function: <prefix>Insert
+ * Usage: <prefix>Insert(tree, key[, value]);
+ * --------------------------
+ * This function inserts a key into the tree and returns TRUE.
+ * Like treeInsert, a key that is already there is added again,
+ * unless the tree was instantiated with RBT_UNIQUE. Then the
+ * tree is left unchanged and the function returns FALSE.
+ */
+
+RBT_API bool RBT_FN(Insert)(RBT_ADT tree, RBT_KEY key RBT_VALUE_PARAM){
+	RBT_NODE x,y;
+	int cmp=0;
+
+	y=RBT_NIL;
+	x=tree->root;
+	while(x!=RBT_NIL){
+		y=x;
+		cmp=RBT_COMPARE(key,x->key);
+		if(cmp<0)
+			x=x->left;
+#ifdef RBT_UNIQUE
+		else if(cmp==0)
+			return (FALSE);
+#endif
+		else
+			x=x->right;
+	}
+	RBT_FN(InsertAt)(tree,y,cmp,key RBT_VALUE_ARG);
+	return (TRUE);
+}
+
+#ifdef RBT_VALUE
+/*
+ * Function: <prefix>Upsert
+ * Usage: if(<prefix>Upsert(tree, key, value)) ...
+ * --------------------------
+ * This function stores the value under the key in a single
+ * descent. If the key is already there its value is replaced
+ * and the function returns FALSE, otherwise the key is
+ * inserted and it returns TRUE.
+ */
+
+RBT_API bool RBT_FN(Upsert)(RBT_ADT tree, RBT_KEY key, RBT_VALUE value){
+	RBT_NODE x,y;
+	int cmp=0;
+
+	y=RBT_NIL;
+	x=tree->root;
+	while(x!=RBT_NIL){
+		y=x;
+		cmp=RBT_COMPARE(key,x->key);
+		if(cmp<0)
+			x=x->left;
+		else if(cmp>0)
+			x=x->right;
+		else {
+			x->value=value;
+			return (FALSE);
+		}
+	}
+	RBT_FN(InsertAt)(tree,y,cmp,key,value);
+	return (TRUE);
+}
+#endif
+
+/*
+ * Function: <prefix>Delete
+ * Usage: if(<prefix>Delete(tree, key)) ...
+ * --------------------------
+ * This function deletes one occurrence of the key and
+ * returns FALSE if the key wasn't in the tree.
+ */
+
+RBT_API bool RBT_FN(Delete)(RBT_ADT tree, RBT_KEY key){
+	RBT_NODE x,xParent,y,z;
+	int yColor,cmp;
+
+	z=tree->root;
+	while(z!=RBT_NIL){
+		cmp=RBT_COMPARE(key,z->key);
+		if(cmp<0)
+			z=z->left;
+		else if(cmp>0)
+			z=z->right;
+		else
+			break;
+	}
+	if(z==RBT_NIL) return (FALSE);
+	y=z;
+	yColor=rbtColorOf(y);
+	if(z->left==RBT_NIL){
+		x=z->right;
+		xParent=rbtParentOf(z);
+		RBT_FN(Transplant)(tree,z,z->right);
+	} else if(z->right==RBT_NIL){
+		x=z->left;
+		xParent=rbtParentOf(z);
+		RBT_FN(Transplant)(tree,z,z->left);
+	} else { /* 2 children */
+		y=z->right;
+		while(y->left!=RBT_NIL)
+			y=y->left;
+		yColor=rbtColorOf(y);
+		x=y->right;
+		if(rbtParentOf(y)==z)
+			xParent=y;
+		else {
+			xParent=rbtParentOf(y);
+			RBT_FN(Transplant)(tree,y,y->right);
+			y->right=z->right;
+			rbtSetParent(y->right,y);
+		}
+		RBT_FN(Transplant)(tree,z,y);
+		y->left=z->left;
+		rbtSetParent(y->left,y);
+		rbtSetColor(y,rbtColorOf(z));
+	}
+	if(yColor==RBT_BLACK)
+		RBT_FN(DeleteFixup)(tree,x,xParent);
+	arenaFree(tree->arena,z);
+	tree->size--;
+	return (TRUE);
+}
+
+/*
+ * Function: <prefix>InsertAt
+ * --------------------------
+ * Links a new node below y, which was the last node of the
+ * descent, on the side given by cmp, the last comparison.
+ */
+static void RBT_FN(InsertAt)(RBT_ADT tree, RBT_NODE y, int cmp, RBT_KEY key RBT_VALUE_PARAM){
+	RBT_NODE z;
+
+	z=arenaAlloc(tree->arena);
+	z->key=key;
+#ifdef RBT_VALUE
+	z->value=value;
+#endif
+	z->left=RBT_NIL;
+	z->right=RBT_NIL;
+	z->parentColor=(uintptr_t)y|RBT_RED;
+	if(y==RBT_NIL)
+		tree->root=z;
+	else if(cmp<0)
+		y->left=z;
+	else
+		y->right=z;
+	tree->size++;
+	RBT_FN(InsertFixup)(tree,z);
+}
+
+static void RBT_FN(InsertFixup)(RBT_ADT tree, RBT_NODE z){
+	RBT_NODE p,g,u;
+
+	while(rbtColorOf(p=rbtParentOf(z))==RBT_RED){
+		g=rbtParentOf(p);
+		if(p==g->left){
+			u=g->right;
+			if(rbtColorOf(u)==RBT_RED){
+				rbtSetColor(p,RBT_BLACK);
+				rbtSetColor(u,RBT_BLACK);
+				rbtSetColor(g,RBT_RED);
+				z=g;
+			} else {
+				if(z==p->right){
+					z=p;
+					RBT_FN(LeftRotate)(tree,z);
+					p=rbtParentOf(z);
+				}
+				rbtSetColor(p,RBT_BLACK);
+				rbtSetColor(g,RBT_RED);
+				RBT_FN(RightRotate)(tree,g);
+			}
+		} else { /* (p==g->right) */
+			u=g->left;
+			if(rbtColorOf(u)==RBT_RED){
+				rbtSetColor(p,RBT_BLACK);
+				rbtSetColor(u,RBT_BLACK);
+				rbtSetColor(g,RBT_RED);
+				z=g;
+			} else {
+				if(z==p->left){
+					z=p;
+					RBT_FN(RightRotate)(tree,z);
+					p=rbtParentOf(z);
+				}
+				rbtSetColor(p,RBT_BLACK);
+				rbtSetColor(g,RBT_RED);
+				RBT_FN(LeftRotate)(tree,g);
+			}
+		}
+	}
+	rbtSetColor(tree->root,RBT_BLACK);
+}
+
+static void RBT_FN(DeleteFixup)(RBT_ADT tree, RBT_NODE x, RBT_NODE xParent){
+	RBT_NODE w;
+
+	while(x!=tree->root && rbtColorOf(x)==RBT_BLACK){
+		if(x==xParent->left){
+			w=xParent->right;
+			if(rbtColorOf(w)==RBT_RED){
+				rbtSetColor(w,RBT_BLACK);
+				rbtSetColor(xParent,RBT_RED);
+				RBT_FN(LeftRotate)(tree,xParent);
+				w=xParent->right;
+			}
+			if(rbtColorOf(w->left)==RBT_BLACK && rbtColorOf(w->right)==RBT_BLACK){
+				rbtSetColor(w,RBT_RED);
+				x=xParent;
+				xParent=rbtParentOf(x);
+			} else {
+				if(rbtColorOf(w->right)==RBT_BLACK){
+					rbtSetColor(w->left,RBT_BLACK);
+					rbtSetColor(w,RBT_RED);
+					RBT_FN(RightRotate)(tree,w);
+					w=xParent->right;
+				}
+				rbtSetColor(w,rbtColorOf(xParent));
+				rbtSetColor(xParent,RBT_BLACK);
+				rbtSetColor(w->right,RBT_BLACK);
+				RBT_FN(LeftRotate)(tree,xParent);
+				x=tree->root;
+			}
+		} else { /* (x==xParent->right) */
+			w=xParent->left;
+			if(rbtColorOf(w)==RBT_RED){
+				rbtSetColor(w,RBT_BLACK);
+				rbtSetColor(xParent,RBT_RED);
+				RBT_FN(RightRotate)(tree,xParent);
+				w=xParent->left;
+			}
+			if(rbtColorOf(w->right)==RBT_BLACK && rbtColorOf(w->left)==RBT_BLACK){
+				rbtSetColor(w,RBT_RED);
+				x=xParent;
+				xParent=rbtParentOf(x);
+			} else {
+				if(rbtColorOf(w->left)==RBT_BLACK){
+					rbtSetColor(w->right,RBT_BLACK);
+					rbtSetColor(w,RBT_RED);
+					RBT_FN(LeftRotate)(tree,w);
+					w=xParent->left;
+				}
+				rbtSetColor(w,rbtColorOf(xParent));
+				rbtSetColor(xParent,RBT_BLACK);
+				rbtSetColor(w->left,RBT_BLACK);
+				RBT_FN(RightRotate)(tree,xParent);
+				x=tree->root;
+			}
+		}
+	}
+	if(x!=RBT_NIL)
+		rbtSetColor(x,RBT_BLACK);
+}
+
+static void RBT_FN(LeftRotate)(RBT_ADT tree, RBT_NODE x){
+	RBT_NODE y=x->right,p=rbtParentOf(x);
+
+	x->right=y->left;
+	if(y->left!=RBT_NIL)
+		rbtSetParent(y->left,x);
+	rbtSetParent(y,p);
+	if(p==RBT_NIL)
+		tree->root=y;
+	else if(x==p->left)
+		p->left=y;
+	else
+		p->right=y;
+	y->left=x;
+	rbtSetParent(x,y);
+}
+
+static void RBT_FN(RightRotate)(RBT_ADT tree, RBT_NODE y){
+	RBT_NODE x=y->left,p=rbtParentOf(y);
+
+	y->left=x->right;
+	if(x->right!=RBT_NIL)
+		rbtSetParent(x->right,y);
+	rbtSetParent(x,p);
+	if(p==RBT_NIL)
+		tree->root=x;
+	else if(y==p->right)
+		p->right=x;
+	else
+		p->left=x;
+	x->right=y;
+	rbtSetParent(y,x);
+}
+
+static void RBT_FN(Transplant)(RBT_ADT tree, RBT_NODE u, RBT_NODE v){
+	RBT_NODE p=rbtParentOf(u);
+
+	if(p==RBT_NIL)
+		tree->root=v;
+	else if(u==p->left)
+		p->left=v;
+	else
+		p->right=v;
+	if(v!=RBT_NIL)
+		rbtSetParent(v,p);
+}
+
+#undef RBT_VALUE_PARAM
+#undef RBT_VALUE_ARG
+#undef RBT_VALUE_OUT
+#undef RBT_FOUND_T
+#undef RBT_UNIQUE
+#undef RBT_COMPARE
+#undef RBT_VALUE
+#undef RBT_KEY
+#undef RBT_PREFIX
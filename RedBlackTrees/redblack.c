@@ -6,169 +6,589 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include "redblack.h"
+#include "arena.h"
+#include "platform.h"
 #include "genlib.h"
 
 typedef enum {red,black} colorT;
 
+#ifndef RB_INDEX_NODES
+
+/*
+ * Type: nodeT
+ * ---------------------------
+ * The color is stored in the lowest bit of the parent
+ * pointer, which is always zero since nodes are at least
+ * word aligned. The key and the child pointers come first
+ * so that a search only reads the start of the node. The
+ * children are indexed by direction, see childOf below.
+ * Always use the macros below to reach the fields, they
+ * hide the storage mode.
+ */
 typedef struct nodeT {
-	colorT color;
 	elementT key;
-	struct nodeT *left,*right,*parent;
+#ifdef RB_ORDER_STATISTICS
+	uint32_t count;
+#endif
+	struct nodeT *child[2];
+	uintptr_t parentColor;
 } *nodeT;
 
+#define keyOf(n) ((n)->key)
+#define countOf(n) ((n)->count)
+#define childOf(n,dir) ((n)->child[dir])
+#define parentOf(n) ((nodeT)((n)->parentColor&~(uintptr_t)1))
+#define colorOf(n) ((colorT)((n)->parentColor&1))
+#define setParent(n,p) ((n)->parentColor=(uintptr_t)(p)|((n)->parentColor&1))
+#define setColor(n,c) ((n)->parentColor=((n)->parentColor&~(uintptr_t)1)|(c))
+#define setParentColor(n,p,c) ((n)->parentColor=(uintptr_t)(p)|(c))
+
+/*
+ * The nodes of a tree are allocated from the tree's own
+ * arena, so freeing the tree releases whole slabs instead
+ * of walking every node. The leftmost and rightmost nodes
+ * are kept up to date by every insert and delete.
+ *
+ * While a compaction is in progress, compactArena holds the
+ * block of compactSlots nodes at compactFirst that the nodes
+ * are moved to. compactUsed slots have been handed out and
+ * compactLive of them hold nodes still in the tree. The walk
+ * goes on after compactMark, the node placed last.
+ *
+ * While retiring, freed nodes go to the retired array, oldest
+ * first, instead of the arena.
+ *
+ * With relaxed balance, the red nodes inserted below a red
+ * parent are kept in the violations array until they are
+ * repaired, see linkNode.
+ */
 struct treeCDT {
 	nodeT root;
+	nodeT minNode,maxNode;
+	size_t size;
+#ifdef RB_COUNT_COMPARISONS
+	size_t comparisons;
+#endif
+	arenaADT arena;
+	arenaADT compactArena;
+	nodeT compactFirst,compactMark;
+	size_t compactSlots,compactUsed,compactLive;
+	nodeT *retired;
+	size_t retiredCount,retiredCapacity;
+	bool retiring;
+	nodeT *violations;
+	size_t violationCount,violationCapacity;
+	bool relaxed;
 };
 
+#define inCompactBlock(n) ((uintptr_t)(n)-(uintptr_t)tree->compactFirst < \
+                           tree->compactSlots*sizeof(struct nodeT))
+
 /*
  * nullNode
  * ---------------------------
  * This node is used as a sentinel node.
  * It replaces all instances of NULL in order
  * to simplify the algorithms for insert/delete.
- * nullNode gets initialized once newTree has been
- * called.
+ * The sentinel is shared by all trees and is never
+ * written to, so trees used by different threads
+ * don't touch any common state. It is black and
+ * has no parent.
+ */
+#ifdef RB_ORDER_STATISTICS
+static struct nodeT nilNode={42,0,{&nilNode,&nilNode},black};
+#else
+static struct nodeT nilNode={42,{&nilNode,&nilNode},black};
+#endif
+static const nodeT nullNode=&nilNode;
+
+#else /* RB_INDEX_NODES */
+
+/*
+ * Type: nodeT
+ * ---------------------------
+ * In index mode a node is named by its 32-bit index in
+ * the tree's node array, and the links are indices too.
+ * The color is stored in the lowest bit of parentColor,
+ * above it is the parent index. Since no pointers are
+ * stored, the array can be moved by realloc or memcpy
+ * and a tree holds at most MAX_NODES nodes.
+ */
+typedef uint32_t nodeT;
+
+struct nodeT {
+	elementT key;
+	nodeT child[2];
+	uint32_t parentColor;
+#ifdef RB_ORDER_STATISTICS
+	uint32_t count;
+#endif
+};
+
+#define MAX_NODES 0x7fffffffu
+#define INITIAL_NODES 64
+
+#define keyOf(n) (tree->nodes[n].key)
+#define countOf(n) (tree->nodes[n].count)
+#define childOf(n,dir) (tree->nodes[n].child[dir])
+#define parentOf(n) ((nodeT)(tree->nodes[n].parentColor>>1))
+#define colorOf(n) ((colorT)(tree->nodes[n].parentColor&1))
+#define setParent(n,p) (tree->nodes[n].parentColor=((uint32_t)(p)<<1)|(tree->nodes[n].parentColor&1))
+#define setColor(n,c) (tree->nodes[n].parentColor=(tree->nodes[n].parentColor&~(uint32_t)1)|(c))
+#define setParentColor(n,p,c) (tree->nodes[n].parentColor=((uint32_t)(p)<<1)|(c))
+
+/*
+ * The node array grows by half its size. Deleted nodes are
+ * kept on a free-list linked through their left field,
+ * or in the retired array while retiring.
+ * The leftmost and rightmost nodes are kept up to date by
+ * every insert and delete. Violations are recorded as in
+ * pointer mode.
+ */
+struct treeCDT {
+	nodeT root;
+	nodeT minNode,maxNode;
+	size_t size;
+#ifdef RB_COUNT_COMPARISONS
+	size_t comparisons;
+#endif
+	struct nodeT *nodes;
+	nodeT capacity,used,freeList;
+	nodeT *retired;
+	size_t retiredCount,retiredCapacity;
+	bool retiring;
+	nodeT *violations;
+	size_t violationCount,violationCapacity;
+	bool relaxed;
+};
+
+/*
+ * nullNode
+ * ---------------------------
+ * Index 0 of every node array is the tree's own sentinel,
+ * it is black, has no parent and is never written to
+ * after newTree.
+ */
+#define nullNode ((nodeT)0)
+
+#endif /* RB_INDEX_NODES */
+
+/*
+ * Directions
+ * ---------------------------
+ * childOf(n,LEFT) and childOf(n,RIGHT) are the children of n.
+ * A comparison result picks the direction to take, so the
+ * descents compute the next node instead of branching on it,
+ * and every fixup case is written once for both directions,
+ * with dir and !dir for the two sides.
+ */
+#define LEFT 0
+#define RIGHT 1
+#define leftOf(n) childOf(n,LEFT)
+#define rightOf(n) childOf(n,RIGHT)
+
+/*
+ * A cursor keeps its node as an integer, which holds both
+ * a pointer and an index.
+ */
+#define cursorNode(c) ((nodeT)(c).node)
+
+/*
+ * prefetchNode starts loading node n into the cache.
+ */
+#ifndef RB_INDEX_NODES
+#  define prefetchNode(n) prefetch(n)
+#else
+#  define prefetchNode(n) prefetch(&tree->nodes[n])
+#endif
+
+/*
+ * Constants
+ * ---------------------------
+ * SIZE_UNKNOWN        -- tree->size after a split, until
+ *                        treeSize counts the nodes
+ * PARALLEL_MIN_HEIGHT -- A set operation only forks a thread
+ *                        for subtrees at least this black height
+ * BATCH_GROUP         -- Number of searches findNodeBatch advances
+ *                        together, about the number of cache misses
+ *                        a core can have outstanding
+ * MAX_HEIGHT          -- No red-black tree of size_t nodes is higher,
+ *                        even with relaxed balance, the try
+ *                        functions give up beyond it
+ */
+#define SIZE_UNKNOWN ((size_t)-1)
+#define PARALLEL_MIN_HEIGHT 10
+#define BATCH_GROUP 16
+#define MAX_HEIGHT 192
+
+/*
+ * keyLess is used for the key comparisons of the insert
+ * paths, so RB_COUNT_COMPARISONS can count them.
+ */
+#ifdef RB_COUNT_COMPARISONS
+#  define keyLess(a,b) (tree->comparisons++,(a) < (b))
+#else
+#  define keyLess(a,b) ((a) < (b))
+#endif
+
+/*
+ * Types: setOpT, setTaskT
+ * ---------------------------
+ * A set operation combines the subtrees a and b, which live
+ * in the node storage of tree. Nodes left out of the result
+ * go on the dropped list, linked through their parent field,
+ * and are freed when the whole operation is done. Every
+ * thread of a parallel operation has a task of its own.
  */
-static nodeT nullNode=NULL;
+typedef enum {unionOp,intersectionOp,differenceOp} setOpT;
+
+typedef struct {
+	treeADT tree;
+	setOpT op;
+	nodeT a,b,result;
+	nodeT dropped;
+	int depth,maxDepth;
+} setTaskT;
 
 /* Private Function Prototypes */
-static nodeT newNode(void);
-static void freeNode(nodeT node);
+static nodeT newNode(treeADT tree);
+static nodeT buildSubtree(treeADT tree, nodeT first, size_t lo, size_t hi,
+                          nodeT parent, int depth, int redDepth);
+static void freeNode(treeADT tree, nodeT node);
+static void recycleNode(treeADT tree, nodeT node);
+#ifndef RB_INDEX_NODES
+static void startCompaction(treeADT tree, size_t slots);
+static nodeT moveNode(treeADT tree, nodeT node);
+static void endCompaction(treeADT tree, bool finished);
+#else
+static void compactNodes(treeADT tree);
+#endif
+static nodeT preorderNext(treeADT tree, nodeT node);
+static void findSorted(treeADT tree, nodeT node, const elementT values[],
+                       elementT results[], size_t lo, size_t hi);
+static size_t searchValues(const elementT values[], size_t lo, size_t hi,
+                           elementT value, bool after);
+static nodeT insertPosition(treeADT tree, elementT value);
+static nodeT insertParent(treeADT tree, nodeT node, elementT value);
+static nodeT insertAt(treeADT tree, nodeT parent, elementT value);
+static void linkNode(treeADT tree, nodeT parent, nodeT node);
+static void deleteNode(treeADT tree, nodeT node);
+static void unlinkNode(treeADT tree, nodeT node);
+static void finishTree(treeADT tree, nodeT root, size_t size);
+static nodeT adoptTree(treeADT dest, treeADT src);
+#ifdef RB_INDEX_NODES
+static nodeT moveSubtree(treeADT dest, treeADT src, nodeT node, nodeT parent);
+#endif
+static int subtreeBlackHeight(treeADT tree, nodeT node);
+static nodeT detachNode(treeADT tree, nodeT node);
+static nodeT joinNodes(treeADT tree, nodeT left, nodeT key, nodeT right);
+static nodeT joinTwo(treeADT tree, nodeT left, nodeT right);
+static bool splitNodes(treeADT tree, nodeT node, elementT value,
+                       nodeT *lt, nodeT *gt, nodeT *dropped);
+static treeADT combineTrees(treeADT a, treeADT b, setOpT op);
+static nodeT setOperation(setTaskT *task, nodeT a, nodeT b, int depth);
+static void setTaskThread(void *arg);
+static void dropSubtree(treeADT tree, nodeT node, nodeT *dropped);
+static size_t freeDropped(treeADT tree, nodeT dropped);
+static size_t freeSubtree(treeADT tree, nodeT node);
+static cursorT makeCursor(treeADT tree, nodeT node);
+static nodeT successor(treeADT tree, nodeT node);
+static nodeT predecessor(treeADT tree, nodeT node);
+static bool trySuccessor(treeADT tree, nodeT *node);
+#ifdef RB_ORDER_STATISTICS
+static void updateCount(treeADT tree, nodeT node);
+static void addToCounts(treeADT tree, nodeT node, int delta);
+#endif
+#ifdef RB_INDEX_NODES
+static void growNodes(treeADT tree);
+#endif
+static void recordViolation(treeADT tree, nodeT node);
 static void insertFixup(treeADT tree, nodeT node);
-static void leftRotate(treeADT tree, nodeT node);
-static void rightRotate(treeADT tree, nodeT node);
+static void rotate(treeADT tree, nodeT node, int dir);
 static nodeT nodeToDelete(treeADT tree, elementT value);
-static nodeT treeMinimum(nodeT node);
-static nodeT treeMaximum(nodeT node);
-static void deleteFixup(treeADT tree, nodeT node);
+static nodeT treeMinimum(treeADT tree, nodeT node);
+static nodeT treeMaximum(treeADT tree, nodeT node);
+static void deleteFixup(treeADT tree, nodeT node, nodeT parent);
 static void transplant(treeADT tree, nodeT u, nodeT v);
-static void printPreOrder(nodeT node);
-static void printInOrder(nodeT node);
-static void printPostOrder(nodeT node);
-static void recDisplayTreeStructure(nodeT node, int depth, string label);
-static int recTreeHeight(nodeT node);
+static void printPreOrder(treeADT tree, nodeT node);
+static void printInOrder(treeADT tree, nodeT node);
+static void printPostOrder(treeADT tree, nodeT node);
+static void recDisplayTreeStructure(treeADT tree, nodeT node, int depth, string label);
+static int recTreeHeight(treeADT tree, nodeT node);
 
 /******************* Exported entries **********************/
 
 treeADT newTree(void){
 	treeADT tree;
 
-	if(!nullNode){ //Not yet initialized
-		nullNode=New(nodeT);
-		nullNode->color=black;
-		nullNode->key=42;
-		nullNode->left=nullNode;
-		nullNode->right=nullNode;
-		nullNode->parent=nullNode;
-	}
 	tree=New(treeADT);
 	tree->root=nullNode;
+	tree->minNode=nullNode;
+	tree->maxNode=nullNode;
+	tree->size=0;
+#ifdef RB_COUNT_COMPARISONS
+	tree->comparisons=0;
+#endif
+	tree->retired=NULL;
+	tree->retiredCount=tree->retiredCapacity=0;
+	tree->retiring=FALSE;
+	tree->violations=NULL;
+	tree->violationCount=tree->violationCapacity=0;
+	tree->relaxed=FALSE;
+#ifndef RB_INDEX_NODES
+	tree->arena=newArena(sizeof(struct nodeT));
+	tree->compactArena=NULL;
+	tree->compactMark=nullNode;
+#else
+	tree->nodes=NewArray(INITIAL_NODES,struct nodeT);
+	tree->capacity=INITIAL_NODES;
+	tree->used=1;
+	tree->freeList=nullNode;
+	keyOf(nullNode)=42;
+	leftOf(nullNode)=nullNode;
+	rightOf(nullNode)=nullNode;
+	setParentColor(nullNode,nullNode,black);
+#ifdef RB_ORDER_STATISTICS
+	countOf(nullNode)=0;
+#endif
+#endif
+	return (tree);
+}
+
+treeADT treeBuildFromSorted(const elementT values[], size_t n){
+	treeADT tree;
+	nodeT first;
+	size_t i;
+	int redDepth;
+
+	for(i=1;i<n;i++)
+		if(values[i] < values[i-1])
+			Error("Values are not sorted!");
+	tree=newTree();
+	if(n==0)
+		return (tree);
+#ifndef RB_INDEX_NODES
+	first=arenaAllocArray(tree->arena,n);
+#else
+	if(n>=MAX_NODES)
+		Error("Tree is full!");
+	if(n+1>tree->capacity){
+		tree->nodes=realloc(tree->nodes,(n+1)*sizeof(struct nodeT));
+		if(tree->nodes==NULL)
+			Error("No memory available");
+		tree->capacity=(nodeT)(n+1);
+	}
+	first=1;
+	tree->used=(nodeT)(n+1);
+#endif
+	for(i=0;i<n;i++)
+		keyOf(first+i)=values[i];
+	for(redDepth=0,i=n;i>1;i/=2)
+		redDepth++;
+	tree->root=buildSubtree(tree,first,0,n,nullNode,0,redDepth);
+	tree->minNode=first;
+	tree->maxNode=(nodeT)(first+(n-1));
+	tree->size=n;
 	return (tree);
 }
 
 void freeTree(treeADT tree){
-	freeNode(tree->root);
+	if(tree->retired!=NULL)
+		FreeBlock(tree->retired);
+	if(tree->violations!=NULL)
+		FreeBlock(tree->violations);
+#ifndef RB_INDEX_NODES
+	freeArena(tree->arena);
+	if(tree->compactArena!=NULL)
+		freeArena(tree->compactArena);
+#else
+	FreeBlock(tree->nodes);
+#endif
 	FreeBlock(tree);
 }
 
 elementT findNode(treeADT tree, elementT value){
-	nodeT x=tree->root;
+	nodeT x;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	while(x!=nullNode){
-		if(value < x->key)
-			x=x->left;
-		else if(value > x->key)
-			x=x->right;
-		else /* (value == x->key) */
-			return (x->key);
+	x=tree->root;
+	while(x!=nullNode && keyOf(x)!=value)
+		x=childOf(x,keyOf(x) < value);
+	return (x==nullNode ? NOT_FOUND : keyOf(x));
+}
+
+const elementT *treeFindPtr(treeADT tree, elementT value){
+	nodeT x;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	x=tree->root;
+	while(x!=nullNode && keyOf(x)!=value)
+		x=childOf(x,keyOf(x) < value);
+	return (x==nullNode ? NULL : &keyOf(x));
+}
+
+/*
+ * Implementation notes: findNodeBatch
+ * ---------------------------
+ * Each round moves every unfinished search of the group one
+ * level down and prefetches the node it lands on. By the time
+ * the round comes back to a search, its node has had the
+ * rest of the round to arrive.
+ */
+void findNodeBatch(treeADT tree, const elementT values[], size_t n,
+                   elementT results[]){
+	nodeT x[BATCH_GROUP];
+	size_t i,j,group;
+	bool moved;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	for(i=0;i<n;i+=group){
+		group=(n-i<BATCH_GROUP) ? n-i : BATCH_GROUP;
+		for(j=0;j<group;j++)
+			x[j]=tree->root;
+		do {
+			moved=FALSE;
+			for(j=0;j<group;j++){
+				if(x[j]!=nullNode && keyOf(x[j])!=values[i+j]){
+					x[j]=childOf(x[j],keyOf(x[j]) < values[i+j]);
+					prefetchNode(x[j]);
+					moved=TRUE;
+				}
+			}
+		} while(moved);
+		for(j=0;j<group;j++)
+			results[i+j]=(x[j]==nullNode) ? NOT_FOUND : keyOf(x[j]);
+	}
+}
+
+void treeFindSorted(treeADT tree, const elementT values[], size_t n,
+                    elementT results[]){
+	size_t i;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	for(i=1;i<n;i++)
+		if(values[i] < values[i-1])
+			Error("Values are not sorted!");
+	findSorted(tree,tree->root,values,results,0,n);
+}
+
+cursorT treeInsert(treeADT tree, elementT value){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (makeCursor(tree,insertAt(tree,insertPosition(tree,value),value)));
+}
+
+cursorT treeInsertHint(treeADT tree, cursorT hint, elementT value){
+	nodeT h,x,y;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(!cursorValid(hint))
+		return (treeInsert(tree,value));
+	if(hint.tree!=tree)
+		Error("Cursor belongs to another tree!");
+	h=cursorNode(hint);
+	if(!keyLess(value,keyOf(h))){
+		x=(h==tree->maxNode) ? nullNode : successor(tree,h);
+		if(x==nullNode || keyLess(value,keyOf(x)))
+			y=(rightOf(h)==nullNode) ? h : x;
+		else {
+			for(x=h;parentOf(x)!=nullNode && !keyLess(value,keyOf(parentOf(x)));x=parentOf(x));
+			y=insertParent(tree,x,value);
+		}
+	} else {
+		x=(h==tree->minNode) ? nullNode : predecessor(tree,h);
+		if(x==nullNode || !keyLess(value,keyOf(x)))
+			y=(leftOf(h)==nullNode) ? h : x;
+		else {
+			for(x=h;parentOf(x)!=nullNode && keyLess(value,keyOf(parentOf(x)));x=parentOf(x));
+			y=insertParent(tree,x,value);
+		}
 	}
-	return (NOT_FOUND);
+	return (makeCursor(tree,insertAt(tree,y,value)));
 }
 
-void treeInsert(treeADT tree, elementT value){
-	nodeT x,y,z=newNode();
+bool treeInsertUnique(treeADT tree, elementT value){
+	nodeT x,y;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	z->key=value;
 	y=nullNode;
 	x=tree->root;
 	while(x!=nullNode){
 		y=x;
-		if(z->key < x->key)
-			x=x->left;
-		else // Duplicates are allowed in order to test tree height
-			x=x->right;
-		//else { /* z->key == x->key */
-		//	x->key=z->key;
-		//	FreeBlock(z);
-		//	return;
-		//}
-	}
-	z->parent=y;
-	if(y==nullNode)
-		tree->root=z;
-	else if(z->key < y->key)
-		y->left=z;
-	else /* (z->key >= y->key) */
-		y->right=z;
-	z->color=red;
-	insertFixup(tree,z);
+		if(keyLess(value,keyOf(x)))
+			x=leftOf(x);
+		else if(keyLess(keyOf(x),value))
+			x=rightOf(x);
+		else /* (value == keyOf(x)) */
+			return (FALSE);
+	}
+	insertAt(tree,y,value);
+	return (TRUE);
 }
 
 void treeDelete(treeADT tree, elementT value){
-	nodeT x,y,z;
-	colorT yColor;
+	nodeT z;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
 	z=nodeToDelete(tree,value);
-	if(z==NULL) return;
-	y=z;
-	yColor=y->color;
-	if(z->left==nullNode){
-		x=z->right;
-		transplant(tree,z,z->right);
-	} else if(z->right==nullNode){
-		x=z->left;
-		transplant(tree,z,z->left);
-	} else { /* 2 children */
-		y=treeMinimum(z->right);
-		yColor=y->color;
-		x=y->right;
-		if(y->parent==z)
-			x->parent=y;
-		else {
-			transplant(tree,y,y->right);
-			y->right=z->right;
-			y->right->parent=y;
-		}
-		transplant(tree,z,y);
-		y->left=z->left;
-		y->left->parent=y;
-		y->color=z->color;
+	if(z==nullNode) return;
+	deleteNode(tree,z);
+}
+
+void treeDeleteNode(treeADT tree, cursorT handle){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(!cursorValid(handle))
+		Error("Cursor is past the end!");
+	if(handle.tree!=tree)
+		Error("Cursor belongs to another tree!");
+	deleteNode(tree,cursorNode(handle));
+}
+
+void treeUpdateKey(cursorT handle, elementT value){
+	treeADT tree=handle.tree;
+	nodeT z,prev,next;
+
+	if(!cursorValid(handle))
+		Error("Cursor is past the end!");
+	z=cursorNode(handle);
+	prev=(z==tree->minNode) ? nullNode : predecessor(tree,z);
+	next=(z==tree->maxNode) ? nullNode : successor(tree,z);
+	if((prev==nullNode || !(value < keyOf(prev))) &&
+	   (next==nullNode || !(keyOf(next) < value))){
+		keyOf(z)=value;
+		return;
 	}
-	if(yColor==black)
-		deleteFixup(tree,x);
-	FreeBlock(z);
+	unlinkNode(tree,z);
+	keyOf(z)=value;
+	linkNode(tree,insertPosition(tree,value),z);
 }
 
 void printTree(treeADT tree, traverseOrderT order){
 	
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
 	switch (order) {
 		case preOrder: 
-			printPreOrder(tree->root);
+			printPreOrder(tree,tree->root);
 			break;
 		case inOrder:
-			printInOrder(tree->root);
+			printInOrder(tree,tree->root);
 			break;
 		case postOrder:
-			printPostOrder(tree->root);
+			printPostOrder(tree,tree->root);
 			break;
 		default:
 			printf("Not a valid traverse-order");
@@ -179,271 +599,1628 @@ void printTree(treeADT tree, traverseOrderT order){
 
 void displayTreeStructure(treeADT tree){
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	recDisplayTreeStructure(tree->root, 0, NULL);
+	recDisplayTreeStructure(tree, tree->root, 0, NULL);
 	printf("\n");
 }
 
 void treeDeleteMin(treeADT tree){
-	nodeT node;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	node=treeMinimum(tree->root);
-	treeDelete(tree,node->key);
+	if(tree->minNode!=nullNode)
+		deleteNode(tree,tree->minNode);
 }
 
 void treeDeleteMax(treeADT tree){
-	nodeT node;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->maxNode!=nullNode)
+		deleteNode(tree,tree->maxNode);
+}
+
+bool treeIsEmpty(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (tree->root==nullNode);
+}
+
+elementT treePeekMin(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->minNode==nullNode)
+		Error("Tree is empty!");
+	return (keyOf(tree->minNode));
+}
+
+elementT treePeekMax(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->maxNode==nullNode)
+		Error("Tree is empty!");
+	return (keyOf(tree->maxNode));
+}
+
+elementT treePopMin(treeADT tree){
+	elementT value;
+
+	value=treePeekMin(tree);
+	deleteNode(tree,tree->minNode);
+	return (value);
+}
+
+elementT treePopMax(treeADT tree){
+	elementT value;
+
+	value=treePeekMax(tree);
+	deleteNode(tree,tree->maxNode);
+	return (value);
+}
+
+cursorT treeFirst(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (makeCursor(tree,tree->minNode));
+}
+
+cursorT treeLast(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (makeCursor(tree,tree->maxNode));
+}
+
+bool cursorValid(cursorT cursor){
+	return (cursorNode(cursor)!=nullNode);
+}
+
+void cursorNext(cursorT *cursor){
+	treeADT tree=cursor->tree;
+
+	if(!cursorValid(*cursor))
+		Error("Cursor is past the end!");
+	cursor->node=(uintptr_t)successor(tree,cursorNode(*cursor));
+}
+
+void cursorPrev(cursorT *cursor){
+	treeADT tree=cursor->tree;
+
+	if(!cursorValid(*cursor))
+		Error("Cursor is past the end!");
+	cursor->node=(uintptr_t)predecessor(tree,cursorNode(*cursor));
+}
+
+elementT cursorKey(cursorT cursor){
+#ifdef RB_INDEX_NODES
+	treeADT tree=cursor.tree;
+#endif
+
+	if(!cursorValid(cursor))
+		Error("Cursor is past the end!");
+	return (keyOf(cursorNode(cursor)));
+}
+
+cursorT treeLowerBound(treeADT tree, elementT value){
+	nodeT x,found=nullNode;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	x=tree->root;
+	while(x!=nullNode){
+		if(keyOf(x) < value)
+			x=rightOf(x);
+		else {
+			found=x;
+			x=leftOf(x);
+		}
+	}
+	return (makeCursor(tree,found));
+}
+
+cursorT treeUpperBound(treeADT tree, elementT value){
+	nodeT x,found=nullNode;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	x=tree->root;
+	while(x!=nullNode){
+		if(value < keyOf(x)){
+			found=x;
+			x=leftOf(x);
+		} else
+			x=rightOf(x);
+	}
+	return (makeCursor(tree,found));
+}
+
+cursorT treeFloor(treeADT tree, elementT value){
+	nodeT x,found=nullNode;
+
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	node=treeMaximum(tree->root);
-	treeDelete(tree,node->key);
+	x=tree->root;
+	while(x!=nullNode){
+		if(value < keyOf(x))
+			x=leftOf(x);
+		else {
+			found=x;
+			x=rightOf(x);
+		}
+	}
+	return (makeCursor(tree,found));
+}
+
+cursorT treeCeiling(treeADT tree, elementT value){
+	return (treeLowerBound(tree,value));
+}
+
+void treeRangeScan(treeADT tree, elementT lo, elementT hi,
+                   scanFnT fn, void *clientData){
+	nodeT x;
+
+	x=cursorNode(treeLowerBound(tree,lo));
+	while(x!=nullNode && keyOf(x) < hi){
+		fn(keyOf(x),clientData);
+		x=successor(tree,x);
+	}
+}
+
+size_t treeRangeCount(treeADT tree, elementT lo, elementT hi){
+#ifdef RB_ORDER_STATISTICS
+	if(!(lo < hi))
+		return (0);
+	return (treeRank(tree,hi)-treeRank(tree,lo));
+#else
+	nodeT x;
+	size_t count=0;
+
+	x=cursorNode(treeLowerBound(tree,lo));
+	while(x!=nullNode && keyOf(x) < hi){
+		count++;
+		x=successor(tree,x);
+	}
+	return (count);
+#endif
 }
 
 int treeHeight(treeADT tree){
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
-	return (recTreeHeight(tree->root));
+	return (recTreeHeight(tree,tree->root));
 }
 
 int blackHeight(treeADT tree){
 	nodeT node;
 	int bHeight=0;
 
-	if(tree->root==NULL)
+	if(tree==NULL)
 		Error("Tree not initialized!");
 	node=tree->root;
 	if(node==nullNode) return 0;
-	while(node->left!=nullNode){
-		node=node->left;
-		if(node->color==black)
+	while(leftOf(node)!=nullNode){
+		node=leftOf(node);
+		if(colorOf(node)==black)
 			bHeight+=1;
 	}
 	return (bHeight);
 }
 
-/**************** End of exported entries *******************/
-
-static nodeT newNode(void){
+size_t treeSize(treeADT tree){
 	nodeT node;
 
-	node=New(nodeT);
-	node->color=black;
-	node->key=0;
-	node->left=nullNode;
-	node->right=nullNode;
-	node->parent=nullNode;
-	return (node);
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->size==SIZE_UNKNOWN){
+		tree->size=0;
+		for(node=tree->minNode;node!=nullNode;node=successor(tree,node))
+			tree->size++;
+	}
+	return (tree->size);
 }
 
-static void freeNode(nodeT node){
-	if(node!=nullNode){
-		freeNode(node->left);
-		freeNode(node->right);
-		FreeBlock(node);
+elementT treeSelect(treeADT tree, size_t k){
+	nodeT node;
+#ifdef RB_ORDER_STATISTICS
+	size_t leftCount;
+#endif
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(k>=treeSize(tree))
+		Error("Rank out of range!");
+#ifdef RB_ORDER_STATISTICS
+	node=tree->root;
+	for(;;){
+		leftCount=countOf(leftOf(node));
+		if(k==leftCount)
+			break;
+		if(k<leftCount)
+			node=leftOf(node);
+		else {
+			k-=leftCount+1;
+			node=rightOf(node);
+		}
 	}
+#else
+	if(k<tree->size/2)
+		for(node=tree->minNode;k>0;k--)
+			node=successor(tree,node);
+	else
+		for(node=tree->maxNode,k=tree->size-1-k;k>0;k--)
+			node=predecessor(tree,node);
+#endif
+	return (keyOf(node));
 }
 
-static void insertFixup(treeADT tree, nodeT z){
-	while(z->parent->color==red){
-		if(z->parent==z->parent->parent->left){
-			nodeT y=z->parent->parent->right;
-			if(y->color==red){
-				z->parent->color=black;
-				y->color=black;
-				z->parent->parent->color=red;
-				z=z->parent->parent;
-			} else {
-				if(z==z->parent->right){
-					z=z->parent;
-					leftRotate(tree,z);
-				}
-				z->parent->color=black;
-				z->parent->parent->color=red;
-				rightRotate(tree,z->parent->parent);
-			}
-		} else {/* (z->parent==z->parent->parent->right) */
-			nodeT x=z->parent->parent->left;
-			if(x->color==red){
-				z->parent->color=black;
-				x->color=black;
-				z->parent->parent->color=red;
-				z=z->parent->parent;
-			} else {
-				if(z==z->parent->left){
-					z=z->parent;
-					rightRotate(tree,z);
-				}
-				z->parent->color=black;
-				z->parent->parent->color=red;
-				leftRotate(tree,z->parent->parent);
-			}
-		}
+size_t treeRank(treeADT tree, elementT value){
+	nodeT node;
+	size_t rank=0;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+#ifdef RB_ORDER_STATISTICS
+	node=tree->root;
+	while(node!=nullNode){
+		if(keyOf(node) < value){
+			rank+=countOf(leftOf(node))+1;
+			node=rightOf(node);
+		} else
+			node=leftOf(node);
 	}
-	tree->root->color=black;
+#else
+	for(node=tree->minNode;node!=nullNode && keyOf(node) < value;node=successor(tree,node))
+		rank++;
+#endif
+	return (rank);
 }
 
-static void leftRotate(treeADT tree, nodeT x){
-	nodeT y;
+treeADT treeJoin(treeADT left, elementT value, treeADT right){
+	treeADT tree=left;
+	nodeT k,r;
+	size_t size;
 
-	y=x->right;
-	x->right=y->left;
-	if(y->left!=nullNode)
-		y->left->parent=x;
-	y->parent=x->parent;
-	if(x->parent==nullNode)
-		tree->root=y;
-	else if(x==x->parent->left)
-		x->parent->left=y;
-	else /* (x==x->parent->right) */
-		x->parent->right=y;
-	y->left=x;
-	x->parent=y;
+	if(left==NULL || right==NULL)
+		Error("Tree not initialized!");
+	if(left==right)
+		Error("Can't join a tree with itself!");
+	treeRebalanceStep(left,(size_t)-1);
+	treeRebalanceStep(right,(size_t)-1);
+	if((!treeIsEmpty(left) && value < treePeekMax(left)) ||
+	   (!treeIsEmpty(right) && treePeekMin(right) < value))
+		Error("Trees overlap!");
+	if(left->size==SIZE_UNKNOWN || right->size==SIZE_UNKNOWN)
+		size=SIZE_UNKNOWN;
+	else
+		size=left->size+right->size+1;
+	r=adoptTree(tree,right);
+	k=newNode(tree);
+	keyOf(k)=value;
+	finishTree(tree,joinNodes(tree,tree->root,k,r),size);
+	return (tree);
 }
 
-static void rightRotate(treeADT tree, nodeT y){
-	nodeT x;
+bool treeSplit(treeADT tree, elementT value, treeADT *lt, treeADT *gt){
+	treeADT right;
+	nodeT l,r,dropped=nullNode;
+	bool found;
 
-	x=y->left;
-	y->left=x->right;
-	if(x->right!=nullNode)
-		x->right->parent=y;
-	x->parent=y->parent;
-	if(y->parent==nullNode)
-		tree->root=x;
-	else if(y==y->parent->right)
-		y->parent->right=x;
-	else /* (y==y->parent->left) */
-		y->parent->left=x;
-	x->right=y;
-	y->parent=x;
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	treeRebalanceStep(tree,(size_t)-1);
+	found=splitNodes(tree,tree->root,value,&l,&r,&dropped);
+	freeDropped(tree,dropped);
+#ifndef RB_INDEX_NODES
+	if(tree->compactArena!=NULL)
+		endCompaction(tree,FALSE);
+	right=New(treeADT);
+#ifdef RB_COUNT_COMPARISONS
+	right->comparisons=0;
+#endif
+	right->arena=arenaShare(tree->arena);
+	right->compactArena=NULL;
+	right->compactMark=nullNode;
+	right->retired=NULL;
+	right->retiredCount=right->retiredCapacity=0;
+	right->retiring=FALSE;
+	right->violations=NULL;
+	right->violationCount=right->violationCapacity=0;
+	right->relaxed=FALSE;
+#else
+	right=newTree();
+	r=moveSubtree(right,tree,r,nullNode);
+#endif
+	finishTree(tree,l,SIZE_UNKNOWN);
+	finishTree(right,r,SIZE_UNKNOWN);
+	*lt=tree;
+	*gt=right;
+	return (found);
 }
 
-static nodeT nodeToDelete(treeADT tree, elementT value){
-	nodeT x=tree->root;
+treeADT treeUnion(treeADT a, treeADT b){
+	return (combineTrees(a,b,unionOp));
+}
 
-	while(x!=nullNode){
-		if(value < x->key)
-			x=x->left;
-		else if(value > x->key)
-			x=x->right;
-		else /* (value == x->key) */
-			return (x);
-	}
-	return (NULL);
+treeADT treeIntersection(treeADT a, treeADT b){
+	return (combineTrees(a,b,intersectionOp));
 }
 
-static nodeT treeMinimum(nodeT node){
+treeADT treeDifference(treeADT a, treeADT b){
+	return (combineTrees(a,b,differenceOp));
+}
 
-	while(node->left!=nullNode)
-		node=node->left;
-	return (node);
+size_t treeComparisons(treeADT tree){
+	if(tree==NULL)
+		Error("Tree not initialized!");
+#ifdef RB_COUNT_COMPARISONS
+	return (tree->comparisons);
+#else
+	return (0);
+#endif
+}
+
+size_t treeMemoryUsage(treeADT tree){
+#ifndef RB_INDEX_NODES
+	return (sizeof(struct treeCDT)+arenaBytes(tree->arena)+
+		(tree->compactArena==NULL ? 0 : arenaBytes(tree->compactArena)));
+#else
+	return (sizeof(struct treeCDT)+tree->capacity*sizeof(struct nodeT));
+#endif
 }
 
-static nodeT treeMaximum(nodeT node){
+void treeCompact(treeADT tree){
 
-	while(node->right!=nullNode)
-		node=node->right;
-	return (node);
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->retiring)
+		Error("Nodes are being retired!");
+	treeRebalanceStep(tree,(size_t)-1);
+#ifndef RB_INDEX_NODES
+	if(tree->compactArena==NULL)
+		startCompaction(tree,treeSize(tree));
+	treeCompactStep(tree,(size_t)-1);
+#else
+	compactNodes(tree);
+#endif
 }
 
-static void deleteFixup(treeADT tree, nodeT x){
-	nodeT w;
+/*
+ * Implementation notes: treeCompactStep
+ * ---------------------------
+ * Each step goes on with the preorder walk after the node
+ * placed last and moves every node it meets that is not yet
+ * in the new block. Nodes inserted meanwhile are put in the
+ * block by newNode. Rotations between the steps may reorder
+ * the walk and skip a few nodes, so when it reaches the end
+ * it starts over from the root, until every node of the tree
+ * is in the block. Without changes in between, one walk does it.
+ */
+bool treeCompactStep(treeADT tree, size_t budget){
+#ifndef RB_INDEX_NODES
+	nodeT x;
 
-	while(x!=tree->root && x->color==black){
-		if(x==x->parent->left){
-			w=x->parent->right;
-			if(w->color==red){
-				w->color=black;
-				x->parent->color=red;
-				leftRotate(tree,x->parent);
-				w=x->parent->right;
-			}
-			if(w->left->color==black && w->right->color==black){
-				w->color=red;
-				x=x->parent;
-			} else { /* something red */
-				if(w->right->color==black){
-					w->left->color=black;
-					w->color=red;
-					rightRotate(tree,w);
-					w=x->parent->right;
-				}
-				w->color=x->parent->color;
-				x->parent->color=black;
-				w->right->color=black;
-				leftRotate(tree,x->parent);
-				x=tree->root;
-			}
-		} else { /* (x=x->parent->right) */
-			w=x->parent->left;
-			if(w->color=red){
-				w->color=black;
-				x->parent->color=red;
-				rightRotate(tree,x->parent);
-				w=x->parent->left;
-			}
-			if(w->right->color==black && w->left->color==black){
-				w->color=red;
-				x=x->parent;
-			} else { /* something red */
-				if(w->left->color==black){
-					w->right->color=black;
-					w->color=red;
-					leftRotate(tree,w);
-					w=x->parent->left;
-				}
-				w->color=x->parent->color;
-				x->parent->color=black;
-				w->left->color=black;
-				rightRotate(tree,x->parent);
-				x=tree->root;
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->retiring)
+		Error("Nodes are being retired!");
+	treeRebalanceStep(tree,(size_t)-1);
+	if(tree->compactArena==NULL)
+		startCompaction(tree,treeSize(tree)+treeSize(tree)/8);
+	while(tree->compactLive<tree->size){
+		if(budget==0)
+			return (FALSE);
+		budget--;
+		if(tree->compactMark==nullNode)
+			x=tree->root;
+		else
+			x=preorderNext(tree,tree->compactMark);
+		if(x!=nullNode && !inCompactBlock(x)){
+			if(tree->compactUsed==tree->compactSlots){
+				endCompaction(tree,FALSE);
+				return (TRUE);
 			}
+			x=moveNode(tree,x);
 		}
+		tree->compactMark=x;
 	}
-	x->color=black;
-	nullNode->parent=nullNode; //Reset parent, transplant() may have changed it.
+	endCompaction(tree,TRUE);
+#else
+	(void)budget;
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->retiring)
+		Error("Nodes are being retired!");
+	treeRebalanceStep(tree,(size_t)-1);
+	compactNodes(tree);
+#endif
+	return (TRUE);
 }
 
-static void transplant(treeADT tree, nodeT u, nodeT v){
+/*
+ * Implementation notes: treeTryFind, treeTryRange
+ * ---------------------------
+ * Every pointer read from a node is one the tree held at some
+ * point, and retired nodes keep theirs, so the walks only ever
+ * reach nodes. The step limits are all they need beyond that.
+ */
+bool treeTryFind(treeADT tree, elementT value, elementT *result){
+	nodeT x;
+	int steps;
 
-	if(u->parent==nullNode)
-		tree->root=v;
-	else if(u==u->parent->left)
-		u->parent->left=v;
-	else /* (u==u->parent->right) */
-		u->parent->right=v;
-	v->parent=u->parent;
+	x=tree->root;
+	for(steps=0;steps<MAX_HEIGHT;steps++){
+		if(x==nullNode || keyOf(x)==value){
+			*result=(x==nullNode) ? NOT_FOUND : value;
+			return (TRUE);
+		}
+		x=childOf(x,keyOf(x) < value);
+	}
+	return (FALSE);
+}
+
+bool treeTryRange(treeADT tree, elementT lo, elementT hi,
+                  elementT values[], size_t max, size_t *n){
+	nodeT x,found=nullNode;
+	size_t count=0;
+	int steps;
+
+	x=tree->root;
+	for(steps=0;x!=nullNode;steps++){
+		if(steps==MAX_HEIGHT)
+			return (FALSE);
+		if(keyOf(x) < lo)
+			x=rightOf(x);
+		else {
+			found=x;
+			x=leftOf(x);
+		}
+	}
+	for(x=found;x!=nullNode && keyOf(x) < hi;count++){
+		if(count==max){
+			count++;
+			break;
+		}
+		values[count]=keyOf(x);
+		if(!trySuccessor(tree,&x))
+			return (FALSE);
+	}
+	*n=count;
+	return (TRUE);
+}
+
+void treeRetireNodes(treeADT tree, bool retire){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+#ifndef RB_INDEX_NODES
+	if(retire && tree->compactArena!=NULL)
+		endCompaction(tree,FALSE);
+#endif
+	tree->retiring=retire;
+}
+
+size_t treeRetired(treeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (tree->retiredCount);
+}
+
+void treeReclaim(treeADT tree, size_t n){
+	size_t i;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(n>tree->retiredCount)
+		Error("Not that many nodes are retired!");
+	for(i=0;i<n;i++)
+		recycleNode(tree,tree->retired[i]);
+	tree->retiredCount-=n;
+	if(n>0)
+		memmove(tree->retired,tree->retired+n,tree->retiredCount*sizeof(nodeT));
+}
+
+void treeRelaxBalance(treeADT tree, bool relaxed){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(!relaxed)
+		treeRebalanceStep(tree,(size_t)-1);
+	tree->relaxed=relaxed;
+}
+
+/*
+ * Implementation notes: treeRebalanceStep
+ * ---------------------------
+ * The newest violations are repaired first. A recorded node
+ * may have been turned black or moved below a black node by
+ * an earlier repair, then there is nothing left to do for it.
+ */
+size_t treeRebalanceStep(treeADT tree, size_t budget){
+	nodeT z;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	for(;tree->violationCount>0 && budget>0;budget--){
+		z=tree->violations[--tree->violationCount];
+		if(colorOf(z)==red)
+			insertFixup(tree,z);
+	}
+	return (tree->violationCount);
+}
+
+/**************** End of exported entries *******************/
+
+static nodeT newNode(treeADT tree){
+	nodeT node;
+
+#ifndef RB_INDEX_NODES
+	if(tree->compactArena!=NULL && tree->compactUsed<tree->compactSlots){
+		node=tree->compactFirst+tree->compactUsed++;
+		tree->compactLive++;
+	} else
+		node=arenaAlloc(tree->arena);
+#else
+	if(tree->freeList!=nullNode){
+		node=tree->freeList;
+		tree->freeList=leftOf(node);
+	} else {
+		if(tree->used==tree->capacity)
+			growNodes(tree);
+		node=tree->used++;
+	}
+#endif
+	keyOf(node)=0;
+	leftOf(node)=nullNode;
+	rightOf(node)=nullNode;
+	setParentColor(node,nullNode,black);
+	return (node);
+}
+
+/*
+ * Function: buildSubtree
+ * ---------------------------
+ * Links the nodes first+lo..first+hi-1, whose keys are already
+ * set, into a balanced subtree and returns its root. Halves
+ * never differ by more than one node, so every level above
+ * redDepth is full. Coloring redDepth red and the rest black
+ * gives every path the same black height.
+ */
+static nodeT buildSubtree(treeADT tree, nodeT first, size_t lo, size_t hi,
+                          nodeT parent, int depth, int redDepth){
+	nodeT x;
+	size_t mid;
+
+	if(lo==hi)
+		return (nullNode);
+	mid=lo+(hi-lo)/2;
+	x=(nodeT)(first+mid);
+	setParentColor(x,parent,(depth==redDepth && depth>0) ? red : black);
+	leftOf(x)=buildSubtree(tree,first,lo,mid,x,depth+1,redDepth);
+	rightOf(x)=buildSubtree(tree,first,mid+1,hi,x,depth+1,redDepth);
+#ifdef RB_ORDER_STATISTICS
+	countOf(x)=(uint32_t)(hi-lo);
+#endif
+	return (x);
+}
+
+#ifdef RB_INDEX_NODES
+/*
+ * Function: growNodes
+ * ---------------------------
+ * Grows the node array by half its size, which wastes less
+ * memory than doubling on very large trees. Its size in bytes
+ * can only overflow where size_t has 32 bits.
+ */
+static void growNodes(treeADT tree){
+	nodeT capacity;
+
+	if(tree->capacity==MAX_NODES)
+		Error("Tree is full!");
+	capacity=tree->capacity+tree->capacity/2;
+	if(capacity>MAX_NODES)
+		capacity=MAX_NODES;
+#if SIZE_MAX <= UINT32_MAX
+	if(capacity>SIZE_MAX/sizeof(struct nodeT))
+		Error("No memory available");
+#endif
+	tree->nodes=realloc(tree->nodes,capacity*sizeof(struct nodeT));
+	if(tree->nodes==NULL)
+		Error("No memory available");
+	tree->capacity=capacity;
+}
+#endif
+
+/*
+ * Functions: freeNode, recycleNode
+ * ---------------------------
+ * freeNode retires the node while retiring is on and hands it
+ * to recycleNode otherwise, which makes it available to newNode.
+ */
+static void freeNode(treeADT tree, nodeT node){
+
+	if(!tree->retiring){
+		recycleNode(tree,node);
+		return;
+	}
+	if(tree->retiredCount==tree->retiredCapacity){
+		tree->retiredCapacity=(tree->retiredCapacity==0) ? 64 : 2*tree->retiredCapacity;
+		tree->retired=realloc(tree->retired,tree->retiredCapacity*sizeof(nodeT));
+		if(tree->retired==NULL)
+			Error("No memory available");
+	}
+	tree->retired[tree->retiredCount++]=node;
+}
+
+static void recycleNode(treeADT tree, nodeT node){
+#ifndef RB_INDEX_NODES
+	if(tree->compactArena!=NULL && inCompactBlock(node)){
+		arenaFree(tree->compactArena,node);
+		tree->compactLive--;
+	} else
+		arenaFree(tree->arena,node);
+#else
+	leftOf(node)=tree->freeList;
+	tree->freeList=node;
+#endif
+}
+
+#ifndef RB_INDEX_NODES
+/*
+ * Functions: startCompaction, moveNode, endCompaction
+ * ---------------------------
+ * startCompaction takes a block of the given number of slots
+ * from a new arena. moveNode copies x into the
+ * next slot of the block, points its neighbours at the copy
+ * and frees x. endCompaction gives the unused slots to the new
+ * arena. When finished, every node is in the block and the old
+ * arena is dropped, else the two arenas are merged.
+ */
+static void startCompaction(treeADT tree, size_t slots){
+
+	tree->compactSlots=slots;
+	tree->compactArena=newArena(sizeof(struct nodeT));
+	if(tree->compactSlots>0)
+		tree->compactFirst=arenaAllocArray(tree->compactArena,tree->compactSlots);
+	else
+		tree->compactFirst=nullNode;
+	tree->compactUsed=0;
+	tree->compactLive=0;
+	tree->compactMark=nullNode;
+}
+
+static nodeT moveNode(treeADT tree, nodeT x){
+	nodeT y,p;
+
+	y=tree->compactFirst+tree->compactUsed++;
+	tree->compactLive++;
+	*y=*x;
+	p=parentOf(x);
+	if(p==nullNode)
+		tree->root=y;
+	else
+		childOf(p,x==rightOf(p))=y;
+	if(leftOf(y)!=nullNode)
+		setParent(leftOf(y),y);
+	if(rightOf(y)!=nullNode)
+		setParent(rightOf(y),y);
+	if(tree->minNode==x)
+		tree->minNode=y;
+	if(tree->maxNode==x)
+		tree->maxNode=y;
+	arenaFree(tree->arena,x);
+	return (y);
+}
+
+static void endCompaction(treeADT tree, bool finished){
+	size_t i;
+
+	for(i=tree->compactSlots;i>tree->compactUsed;i--)
+		arenaFree(tree->compactArena,tree->compactFirst+(i-1));
+	if(finished){
+		freeArena(tree->arena);
+		tree->arena=tree->compactArena;
+	} else {
+		arenaMerge(tree->arena,tree->compactArena);
+		freeArena(tree->compactArena);
+	}
+	tree->compactArena=NULL;
+	tree->compactMark=nullNode;
+}
+
+#else
+
+/*
+ * Function: compactNodes
+ * ---------------------------
+ * Copies the nodes into a new array in preorder, renumbering
+ * the links through a table from old to new index. The new
+ * array has no free slots.
+ */
+static void compactNodes(treeADT tree){
+	struct nodeT *nodes;
+	nodeT *newIndex,x,y,n;
+
+	newIndex=NewArray(tree->used,nodeT);
+	newIndex[nullNode]=nullNode;
+	n=1;
+	for(x=tree->root;x!=nullNode;x=preorderNext(tree,x))
+		newIndex[x]=n++;
+	nodes=NewArray(n<INITIAL_NODES ? INITIAL_NODES : n,struct nodeT);
+	nodes[nullNode]=tree->nodes[nullNode];
+	for(x=tree->root;x!=nullNode;x=preorderNext(tree,x)){
+		y=newIndex[x];
+		nodes[y]=tree->nodes[x];
+		nodes[y].child[LEFT]=newIndex[leftOf(x)];
+		nodes[y].child[RIGHT]=newIndex[rightOf(x)];
+		nodes[y].parentColor=(newIndex[parentOf(x)]<<1)|colorOf(x);
+	}
+	tree->root=newIndex[tree->root];
+	tree->minNode=newIndex[tree->minNode];
+	tree->maxNode=newIndex[tree->maxNode];
+	FreeBlock(newIndex);
+	FreeBlock(tree->nodes);
+	tree->nodes=nodes;
+	tree->capacity=(n<INITIAL_NODES) ? INITIAL_NODES : n;
+	tree->used=n;
+	tree->freeList=nullNode;
+}
+#endif
+
+/*
+ * Function: preorderNext
+ * ---------------------------
+ * Returns the node after x in preorder, parent before
+ * children, or nullNode after the last.
+ */
+static nodeT preorderNext(treeADT tree, nodeT x){
+	nodeT p;
+
+	if(leftOf(x)!=nullNode)
+		return (leftOf(x));
+	if(rightOf(x)!=nullNode)
+		return (rightOf(x));
+	for(p=parentOf(x);p!=nullNode;x=p,p=parentOf(p))
+		if(x==leftOf(p) && rightOf(p)!=nullNode)
+			return (rightOf(p));
+	return (nullNode);
+}
+
+/*
+ * Function: findSorted
+ * ---------------------------
+ * Looks up values[lo..hi-1] in the subtree x. The values equal
+ * to the key of x are found there, the smaller ones are looked
+ * up on the left and the larger ones on the right, which is
+ * done by the loop instead of a second recursive call. Both
+ * children are prefetched while the values are split.
+ */
+static void findSorted(treeADT tree, nodeT x, const elementT values[],
+                       elementT results[], size_t lo, size_t hi){
+	size_t i,eq,gt;
+
+	while(lo<hi){
+		if(x==nullNode){
+			for(i=lo;i<hi;i++)
+				results[i]=NOT_FOUND;
+			return;
+		}
+		prefetchNode(leftOf(x));
+		prefetchNode(rightOf(x));
+		eq=searchValues(values,lo,hi,keyOf(x),FALSE);
+		gt=searchValues(values,eq,hi,keyOf(x),TRUE);
+		for(i=eq;i<gt;i++)
+			results[i]=keyOf(x);
+		findSorted(tree,leftOf(x),values,results,lo,eq);
+		lo=gt;
+		x=rightOf(x);
+	}
+}
+
+/*
+ * Function: searchValues
+ * ---------------------------
+ * Binary search in the sorted values[lo..hi-1]. Returns the
+ * index of the first value not less than value, or with after
+ * set, of the first value greater than it; hi if there is none.
+ */
+static size_t searchValues(const elementT values[], size_t lo, size_t hi,
+                           elementT value, bool after){
+	size_t mid;
+
+	while(lo<hi){
+		mid=lo+(hi-lo)/2;
+		if(after ? !(value < values[mid]) : values[mid] < value)
+			lo=mid+1;
+		else
+			hi=mid;
+	}
+	return (lo);
+}
+
+/*
+ * Function: insertPosition
+ * ---------------------------
+ * Returns the parent of a new node holding value. Values
+ * beyond either end of the tree go straight below the cached
+ * minimum or maximum, so ordered input makes no descent.
+ */
+static nodeT insertPosition(treeADT tree, elementT value){
+	if(tree->root==nullNode)
+		return (nullNode);
+	if(!keyLess(value,keyOf(tree->maxNode)))
+		return (tree->maxNode);
+	if(keyLess(value,keyOf(tree->minNode)))
+		return (tree->minNode);
+	return (insertParent(tree,tree->root,value));
+}
+
+/*
+ * Function: insertParent
+ * ---------------------------
+ * Descends from x to the leaf position of value and returns
+ * the node that becomes its parent, or nullNode if the tree
+ * is empty. Duplicates go to the right.
+ */
+static nodeT insertParent(treeADT tree, nodeT x, elementT value){
+	nodeT y=nullNode;
+
+	while(x!=nullNode){
+		y=x;
+		// Duplicates are allowed in order to test tree height
+		x=childOf(x,!keyLess(value,keyOf(x)));
+	}
+	return (y);
+}
+
+/*
+ * Functions: insertAt, linkNode
+ * ---------------------------
+ * insertAt puts value in a new node below y, which must be
+ * the node insertPosition or insertParent returned for it.
+ * linkNode does the same for a node that is not in the tree,
+ * reusing it, and restores the balance.
+ *
+ * With relaxed balance, a red node below a red parent is only
+ * recorded, unless the parent is itself a recorded violation.
+ * So no path holds three red nodes in a row, and the tree is
+ * at most 3 lg n high instead of 2 lg n. The black heights
+ * stay equal throughout.
+ */
+static nodeT insertAt(treeADT tree, nodeT y, elementT value){
+	nodeT z;
+
+	z=newNode(tree);
+	keyOf(z)=value;
+	linkNode(tree,y,z);
+	return (z);
+}
+
+static void linkNode(treeADT tree, nodeT y, nodeT z){
+	int dir;
+
+	leftOf(z)=nullNode;
+	rightOf(z)=nullNode;
+	setParent(z,y);
+	if(tree->size!=SIZE_UNKNOWN)
+		tree->size++;
+#ifdef RB_ORDER_STATISTICS
+	countOf(z)=1;
+	addToCounts(tree,y,1);
+#endif
+	setColor(z,red);
+	if(y==nullNode){
+		tree->root=z;
+		tree->minNode=z;
+		tree->maxNode=z;
+	} else {
+		dir=!keyLess(keyOf(z),keyOf(y));
+		childOf(y,dir)=z;
+		if(y==tree->minNode && dir==LEFT)
+			tree->minNode=z;
+		else if(y==tree->maxNode && dir==RIGHT)
+			tree->maxNode=z;
+	}
+	if(tree->relaxed && colorOf(y)==red && colorOf(parentOf(y))==black)
+		recordViolation(tree,z);
+	else
+		insertFixup(tree,z);
+}
+
+/*
+ * Functions: deleteNode, unlinkNode
+ * ---------------------------
+ * unlinkNode takes z out of the tree and restores the balance,
+ * deleteNode also frees z. The cached minimum and maximum move
+ * to the neighbours of z before it is unlinked. deleteFixup
+ * needs a valid red-black tree, and z may be a recorded
+ * violation, so all violations are repaired first.
+ */
+static void deleteNode(treeADT tree, nodeT z){
+#ifndef RB_INDEX_NODES
+	if(z==tree->compactMark)
+		tree->compactMark=parentOf(z);
+#endif
+	unlinkNode(tree,z);
+	freeNode(tree,z);
+}
+
+static void unlinkNode(treeADT tree, nodeT z){
+	nodeT x,xParent,y;
+	colorT yColor;
+
+	if(tree->violationCount>0)
+		treeRebalanceStep(tree,(size_t)-1);
+	if(z==tree->minNode)
+		tree->minNode=successor(tree,z);
+	if(z==tree->maxNode)
+		tree->maxNode=predecessor(tree,z);
+	if(tree->size!=SIZE_UNKNOWN)
+		tree->size--;
+#ifdef RB_ORDER_STATISTICS
+	if(leftOf(z)==nullNode || rightOf(z)==nullNode)
+		addToCounts(tree,parentOf(z),-1);
+	else
+		addToCounts(tree,parentOf(treeMinimum(tree,rightOf(z))),-1);
+#endif
+	y=z;
+	yColor=colorOf(y);
+	if(leftOf(z)==nullNode){
+		x=rightOf(z);
+		xParent=parentOf(z);
+		transplant(tree,z,rightOf(z));
+	} else if(rightOf(z)==nullNode){
+		x=leftOf(z);
+		xParent=parentOf(z);
+		transplant(tree,z,leftOf(z));
+	} else { /* 2 children */
+		y=treeMinimum(tree,rightOf(z));
+		yColor=colorOf(y);
+		x=rightOf(y);
+		if(parentOf(y)==z)
+			xParent=y;
+		else {
+			xParent=parentOf(y);
+			transplant(tree,y,rightOf(y));
+			rightOf(y)=rightOf(z);
+			setParent(rightOf(y),y);
+		}
+		transplant(tree,z,y);
+		leftOf(y)=leftOf(z);
+		setParent(leftOf(y),y);
+		setColor(y,colorOf(z));
+#ifdef RB_ORDER_STATISTICS
+		countOf(y)=countOf(z);
+#endif
+	}
+	if(yColor==black)
+		deleteFixup(tree,x,xParent);
+}
+
+/*
+ * Function: finishTree
+ * ---------------------------
+ * Makes root the black root of the tree and refreshes the
+ * cached minimum, maximum and size after a join, split or
+ * set operation.
+ */
+static void finishTree(treeADT tree, nodeT root, size_t size){
+	tree->root=root;
+	if(root!=nullNode)
+		setParentColor(root,nullNode,black);
+	tree->minNode=treeMinimum(tree,root);
+	tree->maxNode=treeMaximum(tree,root);
+#ifdef RB_ORDER_STATISTICS
+	size=countOf(root);
+#endif
+	tree->size=size;
+}
+
+/*
+ * Function: adoptTree
+ * ---------------------------
+ * Moves the nodes of src into the storage of dest, frees src
+ * and returns the root of its nodes. In pointer mode the
+ * arenas are merged in O(number of slabs), in index mode the
+ * nodes are copied into the array of dest in O(n).
+ */
+static nodeT adoptTree(treeADT dest, treeADT src){
+	nodeT root;
+
+#ifndef RB_INDEX_NODES
+	if(dest->compactArena!=NULL)
+		endCompaction(dest,FALSE);
+	if(src->compactArena!=NULL)
+		endCompaction(src,FALSE);
+	treeReclaim(src,src->retiredCount);
+	arenaMerge(dest->arena,src->arena);
+	root=src->root;
+#else
+	root=moveSubtree(dest,src,src->root,nullNode);
+#endif
+	freeTree(src);
+	return (root);
+}
+
+#ifdef RB_INDEX_NODES
+/*
+ * Function: moveSubtree
+ * ---------------------------
+ * Copies the subtree at x from the array of src into the
+ * array of dest, keeping its shape and colors, and frees the
+ * old nodes. newNode may move the array of dest, so no
+ * reference into it is held across the recursive calls.
+ */
+static nodeT moveSubtree(treeADT dest, treeADT src, nodeT x, nodeT parent){
+	treeADT tree=dest;
+	nodeT y,child;
+
+	if(x==nullNode)
+		return (nullNode);
+	y=newNode(dest);
+	tree->nodes[y]=src->nodes[x];
+	setParent(y,parent);
+	child=moveSubtree(dest,src,src->nodes[x].child[LEFT],y);
+	leftOf(y)=child;
+	child=moveSubtree(dest,src,src->nodes[x].child[RIGHT],y);
+	rightOf(y)=child;
+	freeNode(src,x);
+	return (y);
+}
+#endif
+
+/*
+ * Function: subtreeBlackHeight
+ * ---------------------------
+ * Counts the black nodes from x down to a leaf, x included.
+ */
+static int subtreeBlackHeight(treeADT tree, nodeT x){
+	int height=0;
+
+	for(;x!=nullNode;x=leftOf(x))
+		if(colorOf(x)==black)
+			height++;
+	return (height);
+}
+
+/*
+ * Function: detachNode
+ * ---------------------------
+ * Cuts x loose from its parent so it can be used as the
+ * root of a subtree of its own.
+ */
+static nodeT detachNode(treeADT tree, nodeT x){
+	if(x!=nullNode)
+		setParent(x,nullNode);
+	return (x);
+}
+
+/*
+ * Function: joinNodes
+ * ---------------------------
+ * Joins the detached subtrees l and r, where every key of l is
+ * <= key(k) <= every key of r, with k in the middle and returns
+ * the new root. If the black heights differ, k is hung red from
+ * the spine of the higher tree at the first black node of the
+ * lower height and insertFixup repairs the path above it, so
+ * the cost is O(difference in height). The root of the result
+ * may be red.
+ */
+static nodeT joinNodes(treeADT tree, nodeT l, nodeT k, nodeT r){
+	struct treeCDT sub=*tree;
+	nodeT p,c;
+	int hl,hr,h;
+
+	if(l!=nullNode)
+		setColor(l,black);
+	if(r!=nullNode)
+		setColor(r,black);
+	hl=subtreeBlackHeight(tree,l);
+	hr=subtreeBlackHeight(tree,r);
+	p=nullNode;
+	if(hl==hr){
+		leftOf(k)=l;
+		rightOf(k)=r;
+		sub.root=k;
+	} else if(hl>hr){
+		for(c=l,h=hl;colorOf(c)==red || h>hr;c=rightOf(c)){
+			if(colorOf(c)==black)
+				h--;
+			p=c;
+		}
+		leftOf(k)=c;
+		rightOf(k)=r;
+		rightOf(p)=k;
+		sub.root=l;
+	} else {
+		for(c=r,h=hr;colorOf(c)==red || h>hl;c=leftOf(c)){
+			if(colorOf(c)==black)
+				h--;
+			p=c;
+		}
+		leftOf(k)=l;
+		rightOf(k)=c;
+		leftOf(p)=k;
+		sub.root=r;
+	}
+	setParentColor(k,p,p==nullNode ? black : red);
+	if(leftOf(k)!=nullNode)
+		setParent(leftOf(k),k);
+	if(rightOf(k)!=nullNode)
+		setParent(rightOf(k),k);
+#ifdef RB_ORDER_STATISTICS
+	for(c=k;c!=nullNode;c=parentOf(c))
+		updateCount(tree,c);
+#endif
+	if(p!=nullNode)
+		insertFixup(&sub,k);
+	return (sub.root);
+}
+
+/*
+ * Function: joinTwo
+ * ---------------------------
+ * Joins two detached subtrees without a middle key by
+ * taking the minimum of r out and using it as the key.
+ */
+static nodeT joinTwo(treeADT tree, nodeT l, nodeT r){
+	struct treeCDT sub=*tree;
+	nodeT k;
+
+	if(l==nullNode)
+		return (r);
+	if(r==nullNode)
+		return (l);
+	sub.root=r;
+	k=treeMinimum(tree,r);
+	unlinkNode(&sub,k);
+	return (joinNodes(tree,l,k,sub.root));
+}
+
+/*
+ * Function: splitNodes
+ * ---------------------------
+ * Splits the detached subtree at x into the keys less than
+ * value and the keys greater than it, joining the pieces on
+ * the way back up. Nodes equal to value go on the dropped
+ * list. Returns TRUE if there were any.
+ */
+static bool splitNodes(treeADT tree, nodeT x, elementT value,
+                       nodeT *lt, nodeT *gt, nodeT *dropped){
+	nodeT l,r,part;
+	bool found;
+
+	if(x==nullNode){
+		*lt=*gt=nullNode;
+		return (FALSE);
+	}
+	l=detachNode(tree,leftOf(x));
+	r=detachNode(tree,rightOf(x));
+	if(value < keyOf(x)){
+		found=splitNodes(tree,l,value,lt,&part,dropped);
+		*gt=joinNodes(tree,part,x,r);
+	} else if(keyOf(x) < value){
+		found=splitNodes(tree,r,value,&part,gt,dropped);
+		*lt=joinNodes(tree,l,x,part);
+	} else {
+		splitNodes(tree,l,value,lt,&part,dropped);
+		splitNodes(tree,r,value,&part,gt,dropped);
+		leftOf(x)=rightOf(x)=nullNode;
+		dropSubtree(tree,x,dropped);
+		found=TRUE;
+	}
+	return (found);
+}
+
+/*
+ * Function: combineTrees
+ * ---------------------------
+ * Runs a set operation on two whole trees. The nodes of b
+ * are moved into the storage of a first, so no node needs to
+ * be allocated while the threads run, and the dropped nodes
+ * are only freed when they are done.
+ */
+static treeADT combineTrees(treeADT a, treeADT b, setOpT op){
+	setTaskT task;
+	size_t size;
+	int n;
+
+	if(a==NULL || b==NULL)
+		Error("Tree not initialized!");
+	if(a==b)
+		Error("Can't combine a tree with itself!");
+	treeRebalanceStep(a,(size_t)-1);
+	treeRebalanceStep(b,(size_t)-1);
+	if(a->size==SIZE_UNKNOWN || b->size==SIZE_UNKNOWN)
+		size=SIZE_UNKNOWN;
+	else
+		size=a->size+b->size;
+	task.tree=a;
+	task.op=op;
+	task.a=a->root;
+	task.b=adoptTree(a,b);
+	task.dropped=nullNode;
+	task.depth=0;
+	for(task.maxDepth=0,n=1;n<processorCount();n*=2)
+		task.maxDepth++;
+	task.result=setOperation(&task,task.a,task.b,0);
+	if(size!=SIZE_UNKNOWN)
+		size-=freeDropped(a,task.dropped);
+	else
+		freeDropped(a,task.dropped);
+	finishTree(a,task.result,size);
+	return (a);
+}
+
+/*
+ * Function: setOperation
+ * ---------------------------
+ * The root k of b splits a, the two halves are combined
+ * recursively and joined again with or without k. Near the
+ * top of large trees the left half is given to a new thread.
+ * The halves share no nodes, and joinNodes and joinTwo only
+ * write to their own copy of the tree header, so the threads
+ * need no locks. When a value is in both trees the node from
+ * b is kept.
+ */
+static nodeT setOperation(setTaskT *task, nodeT a, nodeT b, int depth){
+	treeADT tree=task->tree;
+	setTaskT child;
+	threadADT thread;
+	nodeT k,l1,r1,l2,r2,l,r;
+	bool found,fork;
+
+	if(a==nullNode || b==nullNode){
+		if(task->op==unionOp)
+			return (a==nullNode ? b : a);
+		dropSubtree(tree,b,&task->dropped);
+		if(task->op==differenceOp)
+			return (a);
+		dropSubtree(tree,a,&task->dropped);
+		return (nullNode);
+	}
+	fork=depth<task->maxDepth && subtreeBlackHeight(tree,b)>=PARALLEL_MIN_HEIGHT;
+	k=b;
+	l2=detachNode(tree,leftOf(k));
+	r2=detachNode(tree,rightOf(k));
+	found=splitNodes(tree,a,keyOf(k),&l1,&r1,&task->dropped);
+	if(fork){
+		child=*task;
+		child.a=l1;
+		child.b=l2;
+		child.dropped=nullNode;
+		child.depth=depth+1;
+		thread=newThread(setTaskThread,&child);
+		r=setOperation(task,r1,r2,depth+1);
+		joinThread(thread);
+		l=child.result;
+		dropSubtree(tree,child.dropped,&task->dropped);
+	} else {
+		l=setOperation(task,l1,l2,depth+1);
+		r=setOperation(task,r1,r2,depth+1);
+	}
+	if(task->op==unionOp || (task->op==intersectionOp && found))
+		return (joinNodes(tree,l,k,r));
+	leftOf(k)=rightOf(k)=nullNode;
+	dropSubtree(tree,k,&task->dropped);
+	return (joinTwo(tree,l,r));
+}
+
+static void setTaskThread(void *arg){
+	setTaskT *task=arg;
+
+	task->result=setOperation(task,task->a,task->b,task->depth);
+}
+
+/*
+ * Functions: dropSubtree, freeDropped, freeSubtree
+ * ---------------------------
+ * dropSubtree puts a detached subtree, or a whole dropped
+ * list, in front of the dropped list. freeDropped frees every
+ * node on the list and returns how many there were.
+ */
+static void dropSubtree(treeADT tree, nodeT x, nodeT *dropped){
+	nodeT last;
+
+	if(x==nullNode)
+		return;
+	for(last=x;parentOf(last)!=nullNode;last=parentOf(last));
+	setParent(last,*dropped);
+	*dropped=x;
+}
+
+static size_t freeDropped(treeADT tree, nodeT dropped){
+	nodeT next;
+	size_t n=0;
+
+	while(dropped!=nullNode){
+		next=parentOf(dropped);
+		n+=freeSubtree(tree,dropped);
+		dropped=next;
+	}
+	return (n);
+}
+
+static size_t freeSubtree(treeADT tree, nodeT x){
+	size_t n;
+
+	if(x==nullNode)
+		return (0);
+	n=freeSubtree(tree,leftOf(x))+freeSubtree(tree,rightOf(x))+1;
+	freeNode(tree,x);
+	return (n);
+}
+
+#ifdef RB_ORDER_STATISTICS
+/*
+ * Functions: updateCount, addToCounts
+ * ---------------------------
+ * Every node counts the nodes of its subtree, itself
+ * included. updateCount recomputes one node from its
+ * children, addToCounts adjusts node and all ancestors.
+ */
+static void updateCount(treeADT tree, nodeT x){
+	countOf(x)=countOf(leftOf(x))+countOf(rightOf(x))+1;
+}
+
+static void addToCounts(treeADT tree, nodeT x, int delta){
+	while(x!=nullNode){
+		countOf(x)+=delta;
+		x=parentOf(x);
+	}
+}
+#endif
+
+static cursorT makeCursor(treeADT tree, nodeT node){
+	cursorT cursor;
+
+	cursor.tree=tree;
+	cursor.node=(uintptr_t)node;
+	return (cursor);
+}
+
+static nodeT successor(treeADT tree, nodeT x){
+	nodeT y;
+
+	if(rightOf(x)!=nullNode)
+		return (treeMinimum(tree,rightOf(x)));
+	y=parentOf(x);
+	while(y!=nullNode && x==rightOf(y)){
+		x=y;
+		y=parentOf(y);
+	}
+	return (y);
+}
+
+/*
+ * Function: trySuccessor
+ * ---------------------------
+ * Moves x to its successor like successor, for treeTryRange.
+ * Returns FALSE if the walk gets longer than any tree is high.
+ */
+static bool trySuccessor(treeADT tree, nodeT *x){
+	nodeT y=*x,p;
+	int steps=0;
+
+	if(rightOf(y)!=nullNode){
+		for(y=rightOf(y);leftOf(y)!=nullNode;y=leftOf(y))
+			if(++steps==MAX_HEIGHT)
+				return (FALSE);
+	} else {
+		p=parentOf(y);
+		while(p!=nullNode && y==rightOf(p)){
+			if(++steps==MAX_HEIGHT)
+				return (FALSE);
+			y=p;
+			p=parentOf(p);
+		}
+		y=p;
+	}
+	*x=y;
+	return (TRUE);
+}
+
+static nodeT predecessor(treeADT tree, nodeT x){
+	nodeT y;
+
+	if(leftOf(x)!=nullNode)
+		return (treeMaximum(tree,leftOf(x)));
+	y=parentOf(x);
+	while(y!=nullNode && x==leftOf(y)){
+		x=y;
+		y=parentOf(y);
+	}
+	return (y);
+}
+
+/*
+ * Function: recordViolation
+ * ---------------------------
+ * Adds the red node z, whose parent is red, to the violations.
+ */
+static void recordViolation(treeADT tree, nodeT z){
+
+	if(tree->violationCount==tree->violationCapacity){
+		tree->violationCapacity=(tree->violationCapacity==0) ? 64 : 2*tree->violationCapacity;
+		tree->violations=realloc(tree->violations,tree->violationCapacity*sizeof(nodeT));
+		if(tree->violations==NULL)
+			Error("No memory available");
+	}
+	tree->violations[tree->violationCount++]=z;
+}
+
+/*
+ * Function: insertFixup
+ * ---------------------------
+ * dir is the side of the grandparent g that the parent p
+ * hangs on, the uncle is on the other side. With relaxed
+ * balance g may be red too, when p is a recorded violation,
+ * and that one is repaired first. Its grandparent is black.
+ */
+static void insertFixup(treeADT tree, nodeT z){
+	nodeT p,g,y;
+	int dir;
+
+	while(colorOf(p=parentOf(z))==red){
+		g=parentOf(p);
+		if(colorOf(g)==red){
+			insertFixup(tree,p);
+			continue;
+		}
+		dir=(p==rightOf(g));
+		y=childOf(g,!dir);
+		if(colorOf(y)==red){
+			setColor(p,black);
+			setColor(y,black);
+			setColor(g,red);
+			z=g;
+		} else {
+			if(z==childOf(p,!dir)){
+				z=p;
+				rotate(tree,z,dir);
+				p=parentOf(z);
+			}
+			setColor(p,black);
+			setColor(g,red);
+			rotate(tree,g,!dir);
+		}
+	}
+	setColor(tree->root,black);
+}
+
+/*
+ * Function: rotate
+ * ---------------------------
+ * Rotates x down in direction dir: the child of x on the
+ * other side takes its place and x becomes that child's
+ * child on side dir. rotate(tree,x,LEFT) is the left
+ * rotation of CLRS.
+ */
+static void rotate(treeADT tree, nodeT x, int dir){
+	nodeT y,p;
+
+	y=childOf(x,!dir);
+	p=parentOf(x);
+	childOf(x,!dir)=childOf(y,dir);
+	if(childOf(y,dir)!=nullNode)
+		setParent(childOf(y,dir),x);
+	setParent(y,p);
+	if(p==nullNode)
+		tree->root=y;
+	else
+		childOf(p,x==rightOf(p))=y;
+	childOf(y,dir)=x;
+	setParent(x,y);
+#ifdef RB_ORDER_STATISTICS
+	countOf(y)=countOf(x);
+	updateCount(tree,x);
+#endif
+}
+
+static nodeT nodeToDelete(treeADT tree, elementT value){
+	nodeT x=tree->root;
+
+	while(x!=nullNode && keyOf(x)!=value)
+		x=childOf(x,keyOf(x) < value);
+	return (x);
+}
+
+static nodeT treeMinimum(treeADT tree, nodeT node){
+
+	while(leftOf(node)!=nullNode)
+		node=leftOf(node);
+	return (node);
+}
+
+static nodeT treeMaximum(treeADT tree, nodeT node){
+
+	while(rightOf(node)!=nullNode)
+		node=rightOf(node);
+	return (node);
+}
+
+/*
+ * Function: deleteFixup
+ * ---------------------------
+ * Since the sentinel is never written to, x may be nullNode
+ * without knowing its parent. The parent is therefore passed
+ * along separately and kept up to date while moving up.
+ */
+static void deleteFixup(treeADT tree, nodeT x, nodeT xParent){
+	nodeT w;
+	int dir;
+
+	while(x!=tree->root && colorOf(x)==black){
+		dir=(x!=leftOf(xParent));
+		w=childOf(xParent,!dir);
+		if(colorOf(w)==red){
+			setColor(w,black);
+			setColor(xParent,red);
+			rotate(tree,xParent,dir);
+			w=childOf(xParent,!dir);
+		}
+		if(colorOf(leftOf(w))==black && colorOf(rightOf(w))==black){
+			setColor(w,red);
+			x=xParent;
+			xParent=parentOf(x);
+		} else { /* something red */
+			if(colorOf(childOf(w,!dir))==black){
+				setColor(childOf(w,dir),black);
+				setColor(w,red);
+				rotate(tree,w,!dir);
+				w=childOf(xParent,!dir);
+			}
+			setColor(w,colorOf(xParent));
+			setColor(xParent,black);
+			setColor(childOf(w,!dir),black);
+			rotate(tree,xParent,dir);
+			x=tree->root;
+		}
+	}
+	if(x!=nullNode)
+		setColor(x,black);
+}
+
+static void transplant(treeADT tree, nodeT u, nodeT v){
+
+	if(parentOf(u)==nullNode)
+		tree->root=v;
+	else
+		childOf(parentOf(u),u==rightOf(parentOf(u)))=v;
+	if(v!=nullNode)
+		setParent(v,parentOf(u));
 }
 
-static void printPreOrder(nodeT node){
+static void printPreOrder(treeADT tree, nodeT node){
 
 	if(node!=nullNode){
-		printf("%d ",node->key);
-		printPreOrder(node->left);
-		printPreOrder(node->right);
+		printf("%d ",keyOf(node));
+		printPreOrder(tree,leftOf(node));
+		printPreOrder(tree,rightOf(node));
 	}
 }
 
-static void printInOrder(nodeT node){
+static void printInOrder(treeADT tree, nodeT node){
 
 	if(node!=nullNode){
-		printInOrder(node->left);
-		printf("%d ",node->key);
-		printInOrder(node->right);
+		printInOrder(tree,leftOf(node));
+		printf("%d ",keyOf(node));
+		printInOrder(tree,rightOf(node));
 	}
 }
 
-static void printPostOrder(nodeT node){
+static void printPostOrder(treeADT tree, nodeT node){
 
 	if(node!=nullNode){
-		printPostOrder(node->left);
-		printPostOrder(node->right);
-		printf("%d ",node->key);
+		printPostOrder(tree,leftOf(node));
+		printPostOrder(tree,rightOf(node));
+		printf("%d ",keyOf(node));
 	}
 }
 
@@ -454,28 +2231,28 @@ static void printPostOrder(nodeT node){
  * The original function was written by Eric Roberts for the textbook:
  * "Programming Abstractions in C - A Second Course in Computer Science"
  */
-static void recDisplayTreeStructure(nodeT node, int depth, string label){
+static void recDisplayTreeStructure(treeADT tree, nodeT node, int depth, string label){
 	if(node == nullNode) return;
     printf("%*s", 3 * depth, "");
     if(label != NULL)
 		printf("%s: ", label);
-	if(node->color==black)
+	if(colorOf(node)==black)
 		printf("%s","Bla");
 	else
 		printf("%s","Red");
-    printf("(%d)\n", node->key);
-    recDisplayTreeStructure(node->left, depth + 1, "L");
-    recDisplayTreeStructure(node->right, depth + 1, "R");
+    printf("(%d)\n", keyOf(node));
+    recDisplayTreeStructure(tree, leftOf(node), depth + 1, "L");
+    recDisplayTreeStructure(tree, rightOf(node), depth + 1, "R");
 }
 
-static int recTreeHeight(nodeT node){
+static int recTreeHeight(treeADT tree, nodeT node){
 	int leftHeight,rightHeight;
 	
 	if (node==nullNode) 
 		return 0;
 	else {
-		leftHeight = recTreeHeight(node->left);
-		rightHeight = recTreeHeight(node->right);
+		leftHeight = recTreeHeight(tree, leftOf(node));
+		rightHeight = recTreeHeight(tree, rightOf(node));
 		if (leftHeight > rightHeight) 
 			return(leftHeight+1);
 		else
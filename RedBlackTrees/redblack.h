@@ -3,18 +3,48 @@
  * Author: Kristoffer Johansson
  * --------------------------------
  * This file is used to make red-black trees grow!
+ *
+ * A tree can be used by one thread at a time, and trees used
+ * by different threads don't touch any common state, with
+ * one exception: in pointer mode the two trees treeSplit
+ * returns share one node arena, so neither they nor the
+ * trees later joined or combined with them may be changed
+ * by different threads at the same time.
  */
 
 #ifndef _redblack_h
 #define _redblack_h
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "genlib.h"
 
 /* Constants */
 
 #define NOT_FOUND -9999
 
+/*
+ * Build options
+ * --------------------------
+ * RB_INDEX_NODES -- Define when compiling redblack.c to keep
+ *                   the nodes of a tree in one growable array,
+ *                   linked by 32-bit indices instead of pointers.
+ *                   Nodes shrink to 16 bytes and the storage can
+ *                   be moved without fixing any links, but a tree
+ *                   is limited to 2^31-1 nodes.
+ *
+ * RB_COUNT_COMPARISONS -- Define when compiling redblack.c to count
+ *                   the key comparisons made by inserts, see
+ *                   treeComparisons.
+ *
+ * RB_ORDER_STATISTICS -- Define when compiling redblack.c to store
+ *                   the size of its subtree in every node. This
+ *                   makes treeSelect and treeRank O(log n) at the
+ *                   cost of one counter per node and a walk to the
+ *                   root on every insert and delete. Without it
+ *                   they walk the tree in order, O(n).
+ */
+
 /*
  * Type: traverseOrderT
  * --------------------------
@@ -40,6 +70,21 @@ typedef int elementT;
 
 typedef struct treeCDT *treeADT;
 
+/*
+ * Type: cursorT
+ * --------------------------
+ * A cursor marks one value of a tree, or the position past
+ * its last value. Cursors are small values that are copied
+ * freely and never need to be freed. The fields are private
+ * to redblack.c. A cursor stays valid until the value it
+ * marks is deleted or the tree is compacted.
+ */
+
+typedef struct {
+	treeADT tree;
+	uintptr_t node;
+} cursorT;
+
 /*
  * Function: newTree
  * Usage: tree = newTree();
@@ -49,6 +94,19 @@ typedef struct treeCDT *treeADT;
 
 treeADT newTree(void);
 
+/*
+ * Function: treeBuildFromSorted
+ * Usage: tree = treeBuildFromSorted(values, n);
+ * --------------------------
+ * This function returns a new tree holding the n values,
+ * which must be in nondecreasing order. The tree is built
+ * directly in O(n), perfectly balanced, with all nodes in
+ * one block laid out in key order. The nodes on the
+ * deepest level are red.
+ */
+
+treeADT treeBuildFromSorted(const elementT values[], size_t n);
+
 /*
  * Function: freeTree
  * Usage: freeTree(tree);
@@ -69,14 +127,86 @@ void freeTree(treeADT tree);
 
 elementT findNode(treeADT tree, elementT value);
 
+/*
+ * Function: treeFindPtr
+ * Usage: ptr=treeFindPtr(tree, value);
+ * -------------------------------
+ * This function returns a pointer to the stored value,
+ * or NULL if the value doesn't exist. Unlike findNode it
+ * can't mistake a stored NOT_FOUND for a miss. The pointer
+ * is valid until the tree is next changed.
+ */
+
+const elementT *treeFindPtr(treeADT tree, elementT value);
+
+/*
+ * Function: findNodeBatch
+ * Usage: findNodeBatch(tree, values, n, results);
+ * -------------------------------
+ * This procedure looks up n values and stores what findNode
+ * would return for values[i] in results[i]. The searches are
+ * advanced a level at a time in groups, prefetching the next
+ * node of each, so on trees larger than the cache the misses
+ * of a group overlap instead of following one another.
+ */
+
+void findNodeBatch(treeADT tree, const elementT values[], size_t n,
+                   elementT results[]);
+
+/*
+ * Function: treeFindSorted
+ * Usage: treeFindSorted(tree, values, n, results);
+ * -------------------------------
+ * This procedure does the same as findNodeBatch for values in
+ * nondecreasing order. It makes one descent for the whole
+ * batch, splitting the values between the subtrees at every
+ * node and entering only subtrees that still have values, so
+ * no node is visited twice. For n values in a tree of m that
+ * is O(n log(m/n)) nodes instead of O(n log m).
+ */
+
+void treeFindSorted(treeADT tree, const elementT values[], size_t n,
+                    elementT results[]);
+
 /*
  * Function: treeInsert
  * Usage: treeInsert(tree, value);
+ *        handle = treeInsert(tree, value);
  * -------------------------------
- * This procedure inserts a value into the tree.
+ * This function inserts a value into the tree and returns a
+ * cursor at the new node. The cursor can be kept as a handle
+ * to that very node, also among equal values, for
+ * treeDeleteNode and treeUpdateKey. It stays valid until the
+ * node is deleted, the tree is compacted or the tree is used
+ * up by treeJoin, treeSplit or a set operation.
  */
 
-void treeInsert(treeADT tree, elementT value);
+cursorT treeInsert(treeADT tree, elementT value);
+
+/*
+ * Function: treeInsertHint
+ * Usage: cursor = treeInsertHint(tree, cursor, value);
+ * -------------------------------
+ * This function inserts a value, starting the search at the
+ * value the hint marks instead of at the root, and returns
+ * a cursor at the new value. When values arrive close to the
+ * previous one, passing the returned cursor as the next hint
+ * makes the search O(1) amortized. A hint that is past the
+ * end gives an ordinary insert.
+ */
+
+cursorT treeInsertHint(treeADT tree, cursorT hint, elementT value);
+
+/*
+ * Function: treeInsertUnique
+ * Usage: if(treeInsertUnique(tree, value)) ...
+ * -------------------------------
+ * This function inserts a value unless it already exists,
+ * giving the tree set semantics. It returns TRUE if the
+ * value was inserted. Only one descent is made.
+ */
+
+bool treeInsertUnique(treeADT tree, elementT value);
 
 /*
  * Function: treeDelete
@@ -87,6 +217,29 @@ void treeInsert(treeADT tree, elementT value);
 
 void treeDelete(treeADT tree, elementT value);
 
+/*
+ * Function: treeDeleteNode
+ * Usage: treeDeleteNode(tree, handle);
+ * -------------------------------
+ * This procedure deletes the node the handle marks, without
+ * searching for its value. Only the rebalancing is left,
+ * O(log n) worst case and O(1) amortized.
+ */
+
+void treeDeleteNode(treeADT tree, cursorT handle);
+
+/*
+ * Function: treeUpdateKey
+ * Usage: treeUpdateKey(handle, value);
+ * -------------------------------
+ * This procedure changes the value of the node the handle
+ * marks. If the new value keeps its place among the
+ * neighbours it is just stored, otherwise the node is moved
+ * to its new place. Either way the handle stays valid.
+ */
+
+void treeUpdateKey(cursorT handle, elementT value);
+
 /*
  * Function: displayTree
  * Usage: displayTree(tree, traverseOrder);
@@ -110,7 +263,10 @@ void displayTreeStructure(treeADT tree);
  * Function: treeDeleteMin
  * Usage: treeDeleteMin(tree);
  * -------------------------------
- * This procedure deletes the minimum value.
+ * This procedure deletes the minimum value. The tree keeps
+ * track of its minimum node, so no search is needed and
+ * exactly that node is removed, even among duplicates.
+ * Nothing happens if the tree is empty.
  */
 
 void treeDeleteMin(treeADT tree);
@@ -119,11 +275,158 @@ void treeDeleteMin(treeADT tree);
  * Function: treeDeleteMax
  * Usage: treeDeleteMax(tree);
  * -------------------------------
- * This procedure deletes the maximum value.
+ * This procedure deletes the maximum value, in the
+ * same way as treeDeleteMin.
  */
 
 void treeDeleteMax(treeADT tree);
 
+/*
+ * Function: treeIsEmpty
+ * Usage: if(treeIsEmpty(tree)) ...
+ * -------------------------------
+ * This function returns TRUE if the tree has no values.
+ */
+
+bool treeIsEmpty(treeADT tree);
+
+/*
+ * Function: treePeekMin
+ * Usage: value=treePeekMin(tree);
+ * -------------------------------
+ * This function returns the minimum value in O(1).
+ * It is an error to call it on an empty tree.
+ */
+
+elementT treePeekMin(treeADT tree);
+
+/*
+ * Function: treePeekMax
+ * Usage: value=treePeekMax(tree);
+ * -------------------------------
+ * This function returns the maximum value in O(1).
+ * It is an error to call it on an empty tree.
+ */
+
+elementT treePeekMax(treeADT tree);
+
+/*
+ * Function: treePopMin
+ * Usage: value=treePopMin(tree);
+ * -------------------------------
+ * This function deletes the minimum value and returns it,
+ * which makes the tree usable as a priority queue.
+ * It is an error to call it on an empty tree.
+ */
+
+elementT treePopMin(treeADT tree);
+
+/*
+ * Function: treePopMax
+ * Usage: value=treePopMax(tree);
+ * -------------------------------
+ * This function deletes the maximum value and returns it.
+ * It is an error to call it on an empty tree.
+ */
+
+elementT treePopMax(treeADT tree);
+
+/*
+ * Functions: treeFirst, treeLast
+ * Usage: for(c=treeFirst(tree);cursorValid(c);cursorNext(&c))
+ *            sum+=cursorKey(c);
+ * -------------------------------
+ * These functions return a cursor at the minimum or maximum
+ * value in O(1). On an empty tree the cursor is past the end.
+ */
+
+cursorT treeFirst(treeADT tree);
+cursorT treeLast(treeADT tree);
+
+/*
+ * Function: cursorValid
+ * Usage: if(cursorValid(cursor)) ...
+ * -------------------------------
+ * This function returns FALSE if the cursor has moved past
+ * either end of the tree.
+ */
+
+bool cursorValid(cursorT cursor);
+
+/*
+ * Functions: cursorNext, cursorPrev
+ * Usage: cursorNext(&cursor);
+ * -------------------------------
+ * These procedures move the cursor to the next larger or
+ * smaller value. They follow the parent links, so a full
+ * scan uses no recursion and no memory and each step is
+ * O(1) amortized. Moving a cursor that is past the end is
+ * an error.
+ */
+
+void cursorNext(cursorT *cursor);
+void cursorPrev(cursorT *cursor);
+
+/*
+ * Function: cursorKey
+ * Usage: value=cursorKey(cursor);
+ * -------------------------------
+ * This function returns the value the cursor marks.
+ */
+
+elementT cursorKey(cursorT cursor);
+
+/*
+ * Functions: treeLowerBound, treeUpperBound, treeFloor, treeCeiling
+ * Usage: cursor=treeLowerBound(tree, value);
+ * -------------------------------
+ * These functions search the tree in one descent and return
+ * a cursor at
+ *   treeLowerBound -- the first value >= value
+ *   treeUpperBound -- the first value >  value
+ *   treeFloor      -- the last value  <= value
+ *   treeCeiling    -- the first value >= value
+ * If there is no such value the cursor is past the end.
+ */
+
+cursorT treeLowerBound(treeADT tree, elementT value);
+cursorT treeUpperBound(treeADT tree, elementT value);
+cursorT treeFloor(treeADT tree, elementT value);
+cursorT treeCeiling(treeADT tree, elementT value);
+
+/*
+ * Type: scanFnT
+ * --------------------------
+ * The type of the procedure called by treeRangeScan for
+ * every value in the range.
+ */
+
+typedef void (*scanFnT)(elementT value, void *clientData);
+
+/*
+ * Function: treeRangeScan
+ * Usage: treeRangeScan(tree, lo, hi, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * v with lo <= v < hi, in increasing order. It runs in
+ * O(log n + k) for k values. The tree must not be changed
+ * by fn.
+ */
+
+void treeRangeScan(treeADT tree, elementT lo, elementT hi,
+                   scanFnT fn, void *clientData);
+
+/*
+ * Function: treeRangeCount
+ * Usage: n=treeRangeCount(tree, lo, hi);
+ * -------------------------------
+ * This function returns the number of values v with
+ * lo <= v < hi. It runs in O(log n) when built with
+ * RB_ORDER_STATISTICS and in O(log n + k) otherwise.
+ */
+
+size_t treeRangeCount(treeADT tree, elementT lo, elementT hi);
+
 /*
  * Function: treeHeight
  * Usage: height=treeHeight(tree);
@@ -144,4 +447,229 @@ int treeHeight(treeADT tree);
 
 int blackHeight(treeADT tree);
 
+/*
+ * Function: treeSize
+ * Usage: n=treeSize(tree);
+ * -------------------------------
+ * This function returns the number of values in the tree
+ * in constant time. Duplicates are counted once per insert.
+ */
+
+size_t treeSize(treeADT tree);
+
+/*
+ * Function: treeSelect
+ * Usage: median=treeSelect(tree, treeSize(tree)/2);
+ * -------------------------------
+ * This function returns the k:th smallest value of the tree,
+ * counting from 0. It is an error if k is not less than
+ * treeSize(tree). See RB_ORDER_STATISTICS for the cost.
+ */
+
+elementT treeSelect(treeADT tree, size_t k);
+
+/*
+ * Function: treeRank
+ * Usage: below=treeRank(tree, value);
+ * -------------------------------
+ * This function returns the number of values in the tree that
+ * are less than value, which is also the index treeSelect
+ * gives to the first copy of value if it is present.
+ */
+
+size_t treeRank(treeADT tree, elementT value);
+
+/*
+ * Function: treeJoin
+ * Usage: tree = treeJoin(left, value, right);
+ * -------------------------------
+ * This function returns a tree holding the values of left,
+ * value and the values of right. No value of left may be
+ * greater than value and no value of right less than it.
+ * Both trees are used up and the result reuses left. In
+ * pointer mode it runs in O(log n), plus the time to finish
+ * a compaction in progress on either tree and to give back
+ * the nodes right has retired. With RB_INDEX_NODES the nodes
+ * of right are copied in O(n).
+ */
+
+treeADT treeJoin(treeADT left, elementT value, treeADT right);
+
+/*
+ * Function: treeSplit
+ * Usage: found = treeSplit(tree, value, &lt, &gt);
+ * -------------------------------
+ * This function splits the tree into *lt with the values less
+ * than value and *gt with the values greater than it. Values
+ * equal to it are deleted and the function returns TRUE if
+ * there were any. The tree is used up and *lt reuses it.
+ * In pointer mode it runs in O(log n) and both trees share
+ * the node storage of tree, so they must not be changed by
+ * different threads at the same time. With RB_INDEX_NODES
+ * the nodes of *gt are copied in O(n). Unless built with
+ * RB_ORDER_STATISTICS, the first treeSize call on either
+ * tree counts its values.
+ */
+
+bool treeSplit(treeADT tree, elementT value, treeADT *lt, treeADT *gt);
+
+/*
+ * Functions: treeUnion, treeIntersection, treeDifference
+ * Usage: tree = treeUnion(a, b);
+ * -------------------------------
+ * These functions return the values in a or b, in both a and
+ * b, and in a but not in b. When a value is in both trees the
+ * result keeps the copies of b. Both trees are used up and
+ * the result reuses a. The trees are combined by splitting
+ * and joining in O(m log(n/m + 1)) work, m <= n being the
+ * sizes, and large trees are divided between one thread per
+ * processor.
+ */
+
+treeADT treeUnion(treeADT a, treeADT b);
+treeADT treeIntersection(treeADT a, treeADT b);
+treeADT treeDifference(treeADT a, treeADT b);
+
+/*
+ * Function: treeComparisons
+ * Usage: n=treeComparisons(tree);
+ * -------------------------------
+ * This function returns the number of key comparisons made by
+ * inserts into the tree so far, or 0 unless redblack.c is
+ * built with RB_COUNT_COMPARISONS.
+ */
+
+size_t treeComparisons(treeADT tree);
+
+/*
+ * Function: treeCompact
+ * Usage: treeCompact(tree);
+ * -------------------------------
+ * This procedure moves all nodes of the tree into one new
+ * block, in the order a preorder walk visits them, so that
+ * a search reads nodes lying close together, and gives the
+ * storage of deleted nodes back. It runs in O(n). Cursors
+ * and handles into the tree become invalid.
+ */
+
+void treeCompact(treeADT tree);
+
+/*
+ * Function: treeCompactStep
+ * Usage: while(!treeCompactStep(tree, 1000)) ...
+ * -------------------------------
+ * This function does the work of treeCompact in steps that
+ * visit at most budget nodes each, so that it can be spread
+ * out between other operations, and returns TRUE once the
+ * compaction is done. Inserts and deletes may come between
+ * the steps, new nodes go straight into the new block. If
+ * more than an eighth of the size is inserted before the
+ * compaction is done, it stops early and keeps the old
+ * storage too. Every step makes cursors and handles into
+ * the tree invalid. In index mode the first step does the
+ * whole compaction.
+ */
+
+bool treeCompactStep(treeADT tree, size_t budget);
+
+/*
+ * Function: treeTryFind
+ * Usage: if(treeTryFind(tree, value, &found)) ...
+ * -------------------------------
+ * This function is findNode for readers that search the tree
+ * while another thread changes it, and find out afterwards
+ * whether it did, as sharedtree.h does. It never writes to
+ * the tree, not even the comparison count, and it returns
+ * FALSE instead of descending further than any red-black tree
+ * is high, so a half-changed tree can't make it loop. Else it
+ * sets result to the value or NOT_FOUND and returns TRUE.
+ * The result is only right if the tree didn't change.
+ */
+
+bool treeTryFind(treeADT tree, elementT value, elementT *result);
+
+/*
+ * Function: treeTryRange
+ * Usage: if(treeTryRange(tree, lo, hi, values, max, &n)) ...
+ * -------------------------------
+ * This function copies the values v with lo <= v < hi, in
+ * increasing order, into values, in the way treeTryFind
+ * searches. It stops after max values, and sets n to max+1
+ * if there are more, else to the number of values.
+ */
+
+bool treeTryRange(treeADT tree, elementT lo, elementT hi,
+                  elementT values[], size_t max, size_t *n);
+
+/*
+ * Function: treeRetireNodes
+ * Usage: treeRetireNodes(tree, TRUE);
+ * -------------------------------
+ * This procedure turns retiring on or off. While it is on,
+ * the nodes of deleted values are set aside unchanged instead
+ * of being reused, so that readers still looking at them from
+ * other threads see the nodes they expect, until treeReclaim
+ * gives them back. The tree can't be compacted meanwhile.
+ */
+
+void treeRetireNodes(treeADT tree, bool retire);
+
+/*
+ * Function: treeRetired
+ * Usage: mark=treeRetired(tree);
+ * -------------------------------
+ * This function returns the number of retired nodes that
+ * haven't been given back yet.
+ */
+
+size_t treeRetired(treeADT tree);
+
+/*
+ * Function: treeReclaim
+ * Usage: treeReclaim(tree, mark);
+ * -------------------------------
+ * This procedure gives the n nodes that were retired first
+ * back for reuse.
+ */
+
+void treeReclaim(treeADT tree, size_t n);
+
+/*
+ * Function: treeRelaxBalance
+ * Usage: treeRelaxBalance(tree, TRUE);
+ * -------------------------------
+ * This procedure turns relaxed balance on or off. While it
+ * is on, inserts leave most of their rebalancing for later,
+ * which makes them cheaper during bursts of writes, and the
+ * tree may grow up to 1.5 times as high. treeRebalanceStep
+ * does the work that was left. Deletes, joins, splits, set
+ * operations and compaction do all of it first. Turning
+ * relaxed balance off does all of it too.
+ */
+
+void treeRelaxBalance(treeADT tree, bool relaxed);
+
+/*
+ * Function: treeRebalanceStep
+ * Usage: while(treeRebalanceStep(tree, 100)>0) ...
+ * -------------------------------
+ * This function repairs at most budget of the balance
+ * violations that inserts left with relaxed balance, each in
+ * O(log n), and returns the number left. At 0 the tree is a
+ * red-black tree again. The tree is not thread-safe, so a
+ * background thread must hold the same lock as the writers.
+ */
+
+size_t treeRebalanceStep(treeADT tree, size_t budget);
+
+/*
+ * Function: treeMemoryUsage
+ * Usage: bytes=treeMemoryUsage(tree);
+ * -------------------------------
+ * This function returns the number of bytes held by the tree,
+ * including unused space in its node storage.
+ */
+
+size_t treeMemoryUsage(treeADT tree);
+
 #endif
\ No newline at end of file
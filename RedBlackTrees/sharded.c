@@ -0,0 +1,298 @@
+/*
+ * File: sharded.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the sharded.h interface on top of
+ * redblack.h.
+ */
+
+#include <limits.h>
+#include "sharded.h"
+#include "platform.h"
+#include "genlib.h"
+
+typedef struct {
+	mutexADT lock;
+	treeADT tree;
+} shardT;
+
+/*
+ * Shard i holds the values v with bounds[i-1] <= v < bounds[i],
+ * the first shard has no lower and the last no upper bound.
+ * Equal bounds leave a shard empty. The bounds and the trees
+ * of the shards only change while every shard is locked, so
+ * they can be trusted by a thread holding the lock of any
+ * shard.
+ */
+struct shardedCDT {
+	shardT *shards;
+	elementT *bounds;
+	int count;
+};
+
+/* Private Function Prototypes */
+static int shardOf(shardedADT sharded, elementT value);
+static shardT *lockShard(shardedADT sharded, elementT value, int *index);
+static void scanShards(shardedADT sharded, elementT lo, elementT hi, bool bounded,
+                       scanFnT fn, void *clientData);
+static void lockAll(shardedADT sharded);
+static void unlockAll(shardedADT sharded);
+
+/******************* Exported entries **********************/
+
+shardedADT newShardedTree(int shards, elementT lo, elementT hi){
+	shardedADT sharded;
+	int i;
+
+	if(shards<1 || !(lo < hi))
+		Error("Bad shard layout!");
+	sharded=New(shardedADT);
+	sharded->count=shards;
+	sharded->shards=NewArray(shards,shardT);
+	sharded->bounds=NewArray(shards,elementT);
+	for(i=0;i<shards;i++){
+		sharded->shards[i].lock=newMutex();
+		sharded->shards[i].tree=newTree();
+		sharded->bounds[i]=(elementT)(lo+((int64_t)hi-lo)*(i+1)/shards);
+	}
+	return (sharded);
+}
+
+void freeShardedTree(shardedADT sharded){
+	int i;
+
+	if(sharded==NULL)
+		Error("Tree not initialized!");
+	for(i=0;i<sharded->count;i++){
+		freeMutex(sharded->shards[i].lock);
+		freeTree(sharded->shards[i].tree);
+	}
+	FreeBlock(sharded->shards);
+	FreeBlock(sharded->bounds);
+	FreeBlock(sharded);
+}
+
+void shardedInsert(shardedADT sharded, elementT value){
+	shardT *shard;
+	int i;
+
+	shard=lockShard(sharded,value,&i);
+	treeInsert(shard->tree,value);
+	unlockMutex(shard->lock);
+}
+
+bool shardedDelete(shardedADT sharded, elementT value){
+	shardT *shard;
+	size_t size;
+	int i;
+
+	shard=lockShard(sharded,value,&i);
+	size=treeSize(shard->tree);
+	treeDelete(shard->tree,value);
+	size-=treeSize(shard->tree);
+	unlockMutex(shard->lock);
+	return (size>0);
+}
+
+elementT shardedFind(shardedADT sharded, elementT value){
+	shardT *shard;
+	elementT result;
+	int i;
+
+	shard=lockShard(sharded,value,&i);
+	result=findNode(shard->tree,value);
+	unlockMutex(shard->lock);
+	return (result);
+}
+
+size_t shardedSize(shardedADT sharded){
+	size_t size=0;
+	int i;
+
+	for(i=0;i<sharded->count;i++){
+		lockMutex(sharded->shards[i].lock);
+		size+=treeSize(sharded->shards[i].tree);
+		unlockMutex(sharded->shards[i].lock);
+	}
+	return (size);
+}
+
+void shardedRangeScan(shardedADT sharded, elementT lo, elementT hi,
+                      scanFnT fn, void *clientData){
+	if(lo < hi)
+		scanShards(sharded,lo,hi,TRUE,fn,clientData);
+}
+
+void shardedForEach(shardedADT sharded, scanFnT fn, void *clientData){
+	scanShards(sharded,INT_MIN,INT_MAX,FALSE,fn,clientData);
+}
+
+size_t shardedRangeCount(shardedADT sharded, elementT lo, elementT hi){
+	shardT *shard;
+	elementT from,next;
+	size_t count=0;
+	bool last;
+	int i;
+
+	for(from=lo;from < hi;from=next){
+		shard=lockShard(sharded,from,&i);
+		last=(i==sharded->count-1 || !(sharded->bounds[i] < hi));
+		next=last ? hi : sharded->bounds[i];
+		count+=treeRangeCount(shard->tree,from,next);
+		unlockMutex(shard->lock);
+	}
+	return (count);
+}
+
+/*
+ * Implementation notes: shardedRebalance
+ * ---------------------------
+ * The values are copied out in order and every shard is built
+ * anew from its part with treeBuildFromSorted. Boundary i is
+ * the value at rank (i+1)*n/count, so all values equal to it
+ * go to the shard on its right.
+ */
+bool shardedRebalance(shardedADT sharded, double maxSkew){
+	elementT *values;
+	cursorT cursor;
+	size_t n,total,largest,first,last;
+	int i;
+
+	lockAll(sharded);
+	total=largest=0;
+	for(i=0;i<sharded->count;i++){
+		n=treeSize(sharded->shards[i].tree);
+		total+=n;
+		if(n>largest)
+			largest=n;
+	}
+	if(total==0 || largest<=maxSkew*total/sharded->count){
+		unlockAll(sharded);
+		return (FALSE);
+	}
+	values=NewArray(total,elementT);
+	n=0;
+	for(i=0;i<sharded->count;i++)
+		for(cursor=treeFirst(sharded->shards[i].tree);cursorValid(cursor);cursorNext(&cursor))
+			values[n++]=cursorKey(cursor);
+	for(i=0;i<sharded->count-1;i++)
+		sharded->bounds[i]=values[total*(i+1)/sharded->count];
+	first=0;
+	for(i=0;i<sharded->count;i++){
+		last=first;
+		while(last<total && (i==sharded->count-1 || values[last] < sharded->bounds[i]))
+			last++;
+		freeTree(sharded->shards[i].tree);
+		sharded->shards[i].tree=treeBuildFromSorted(values+first,last-first);
+		first=last;
+	}
+	FreeBlock(values);
+	unlockAll(sharded);
+	return (TRUE);
+}
+
+size_t shardedLargest(shardedADT sharded){
+	size_t n,largest=0;
+	int i;
+
+	for(i=0;i<sharded->count;i++){
+		lockMutex(sharded->shards[i].lock);
+		n=treeSize(sharded->shards[i].tree);
+		unlockMutex(sharded->shards[i].lock);
+		if(n>largest)
+			largest=n;
+	}
+	return (largest);
+}
+
+/**************** End of exported entries *******************/
+
+/*
+ * Function: shardOf
+ * ---------------------------
+ * Returns the index of the shard holding value, the number
+ * of bounds that are <= value, by binary search.
+ */
+static int shardOf(shardedADT sharded, elementT value){
+	int lo=0,hi=sharded->count-1,mid;
+
+	while(lo<hi){
+		mid=(lo+hi)/2;
+		if(value < sharded->bounds[mid])
+			hi=mid;
+		else
+			lo=mid+1;
+	}
+	return (lo);
+}
+
+/*
+ * Function: lockShard
+ * ---------------------------
+ * Locks and returns the shard of value and sets index to its
+ * number. The bounds may change until the lock is taken, so
+ * the shard is looked up again under the lock.
+ */
+static shardT *lockShard(shardedADT sharded, elementT value, int *index){
+	shardT *shard;
+
+	for(;;){
+		*index=shardOf(sharded,value);
+		shard=&sharded->shards[*index];
+		lockMutex(shard->lock);
+		if(shardOf(sharded,value)==*index)
+			return (shard);
+		unlockMutex(shard->lock);
+	}
+}
+
+/*
+ * Function: scanShards
+ * ---------------------------
+ * Visits the values from lo on, below hi if bounded, one
+ * shard at a time. Each shard is entered at the first value
+ * not yet visited, so the order holds even if the bounds
+ * change between two shards.
+ */
+static void scanShards(shardedADT sharded, elementT lo, elementT hi, bool bounded,
+                       scanFnT fn, void *clientData){
+	shardT *shard;
+	cursorT cursor;
+	elementT from,next;
+	bool last;
+	int i;
+
+	for(from=lo;;from=next){
+		shard=lockShard(sharded,from,&i);
+		last=(i==sharded->count-1 || (bounded && !(sharded->bounds[i] < hi)));
+		next=sharded->bounds[i];
+		for(cursor=treeLowerBound(shard->tree,from);cursorValid(cursor);cursorNext(&cursor)){
+			if(bounded && !(cursorKey(cursor) < hi))
+				break;
+			fn(cursorKey(cursor),clientData);
+		}
+		unlockMutex(shard->lock);
+		if(last)
+			break;
+	}
+}
+
+/*
+ * Functions: lockAll, unlockAll
+ * ---------------------------
+ * The shards are always locked in the same order, and other
+ * threads hold at most one lock, so this can't deadlock.
+ */
+static void lockAll(shardedADT sharded){
+	int i;
+
+	for(i=0;i<sharded->count;i++)
+		lockMutex(sharded->shards[i].lock);
+}
+
+static void unlockAll(shardedADT sharded){
+	int i;
+
+	for(i=0;i<sharded->count;i++)
+		unlockMutex(sharded->shards[i].lock);
+}
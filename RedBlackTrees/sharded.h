@@ -0,0 +1,135 @@
+/*
+ * File: sharded.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports sharded trees for many threads that write
+ * at the same time. The key space is cut into ranges, and
+ * each range is a shard: a red-black tree of redblack.h with
+ * its own lock and its own node arena. Threads writing values
+ * in different shards never wait for each other or touch the
+ * same memory, since the sentinel all trees share is never
+ * written.
+ *
+ * Scans and range queries visit the shards in key order, so
+ * they see the values in order, but each shard as it was when
+ * it was visited. When the values pile up in a few shards,
+ * shardedRebalance moves the boundaries.
+ */
+
+#ifndef _sharded_h
+#define _sharded_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Type: shardedADT
+ * --------------------------
+ * The type shardedADT points to the sharded tree's concrete type.
+ */
+
+typedef struct shardedCDT *shardedADT;
+
+/*
+ * Function: newShardedTree
+ * Usage: sharded = newShardedTree(16, 0, 1000000);
+ * --------------------------
+ * This function returns an empty sharded tree whose values
+ * are expected in lo <= v < hi. That range is cut into equal
+ * parts, one per shard. Values outside it go to the first or
+ * the last shard.
+ */
+
+shardedADT newShardedTree(int shards, elementT lo, elementT hi);
+
+/*
+ * Function: freeShardedTree
+ * Usage: freeShardedTree(sharded);
+ * -------------------------------
+ * This procedure frees the storage associated with the tree.
+ */
+
+void freeShardedTree(shardedADT sharded);
+
+/*
+ * Functions: shardedInsert, shardedDelete, shardedFind
+ * Usage: shardedInsert(sharded, value); if(shardedDelete(sharded, value)) ...
+ * -------------------------------
+ * These work like treeInsert, treeDelete and findNode, locking
+ * only the shard of the value. shardedDelete returns FALSE if
+ * the value doesn't exist.
+ */
+
+void shardedInsert(shardedADT sharded, elementT value);
+bool shardedDelete(shardedADT sharded, elementT value);
+elementT shardedFind(shardedADT sharded, elementT value);
+
+/*
+ * Function: shardedSize
+ * Usage: n=shardedSize(sharded);
+ * -------------------------------
+ * This function returns the number of values in the tree.
+ */
+
+size_t shardedSize(shardedADT sharded);
+
+/*
+ * Function: shardedRangeScan
+ * Usage: shardedRangeScan(sharded, lo, hi, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * v with lo <= v < hi, in increasing order, like treeRangeScan.
+ * fn is called with the shard locked, so it must not use
+ * the sharded tree.
+ */
+
+void shardedRangeScan(shardedADT sharded, elementT lo, elementT hi,
+                      scanFnT fn, void *clientData);
+
+/*
+ * Function: shardedForEach
+ * Usage: shardedForEach(sharded, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * in the tree, in increasing order, under the same rules as
+ * shardedRangeScan.
+ */
+
+void shardedForEach(shardedADT sharded, scanFnT fn, void *clientData);
+
+/*
+ * Function: shardedRangeCount
+ * Usage: n=shardedRangeCount(sharded, lo, hi);
+ * -------------------------------
+ * This function returns the number of values v with
+ * lo <= v < hi.
+ */
+
+size_t shardedRangeCount(shardedADT sharded, elementT lo, elementT hi);
+
+/*
+ * Function: shardedRebalance
+ * Usage: if(shardedRebalance(sharded, 2.0)) ...
+ * -------------------------------
+ * If the largest shard holds more than maxSkew times the
+ * average number of values, this function moves the shard
+ * boundaries so that every shard holds about the same number,
+ * and returns TRUE. It stops all other threads' use of the
+ * tree while it runs, which takes O(n). Equal values are never
+ * split between shards.
+ */
+
+bool shardedRebalance(shardedADT sharded, double maxSkew);
+
+/*
+ * Function: shardedLargest
+ * Usage: n=shardedLargest(sharded);
+ * -------------------------------
+ * This function returns the number of values in the largest
+ * shard.
+ */
+
+size_t shardedLargest(shardedADT sharded);
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * File: sharedtree.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the sharedtree.h interface on top of
+ * redblack.h. The readers search with treeTryFind and
+ * treeTryRange, which cope with a tree that changes under them,
+ * and the tree retires deleted nodes instead of reusing them.
+ */
+
+#include "sharedtree.h"
+#include "platform.h"
+#include "epoch.h"
+#include "genlib.h"
+
+/*
+ * Constants
+ * ---------------------------
+ * RECLAIM_BATCH   -- Retired nodes that start a new epoch
+ * INITIAL_VALUES  -- Values a reader's scan buffer starts with
+ */
+#define RECLAIM_BATCH 256
+#define INITIAL_VALUES 64
+
+/*
+ * values holds the values of a range scan until they are
+ * validated.
+ */
+struct sharedReaderCDT {
+	epochSlotADT slot;
+	sharedTreeADT shared;
+	elementT *values;
+	size_t capacity;
+	size_t retries;
+};
+
+/*
+ * sequence is odd while a write is in progress. The nodes
+ * retired before pendingMark can be reclaimed once no reader
+ * is in an epoch before pendingEpoch. The fields after writer
+ * are only used by the thread holding it.
+ */
+struct sharedTreeCDT {
+	volatile int32_t sequence;
+	epochADT epochs;
+	treeADT tree;
+	mutexADT writer;
+	bool pending;
+	int32_t pendingEpoch;
+	size_t pendingMark;
+};
+
+/* Private Function Prototypes */
+static void beginWrite(sharedTreeADT shared);
+static void endWrite(sharedTreeADT shared);
+static void reclaimNodes(sharedTreeADT shared);
+static void growValues(sharedReaderADT reader, size_t n);
+#ifndef RB_INDEX_NODES
+static int32_t beginRead(sharedTreeADT shared);
+static bool endRead(sharedTreeADT shared, int32_t sequence);
+#endif
+
+/******************* Exported entries **********************/
+
+sharedTreeADT newSharedTree(void){
+	sharedTreeADT shared;
+
+	shared=New(sharedTreeADT);
+	shared->sequence=0;
+	shared->epochs=newEpoch();
+	shared->tree=newTree();
+	treeRetireNodes(shared->tree,TRUE);
+	shared->writer=newMutex();
+	shared->pending=FALSE;
+	return (shared);
+}
+
+void freeSharedTree(sharedTreeADT shared){
+
+	if(shared==NULL)
+		Error("Tree not initialized!");
+	freeEpoch(shared->epochs);
+	freeTree(shared->tree);
+	freeMutex(shared->writer);
+	FreeBlock(shared);
+}
+
+void sharedInsert(sharedTreeADT shared, elementT value){
+
+	lockMutex(shared->writer);
+	beginWrite(shared);
+	treeInsert(shared->tree,value);
+	endWrite(shared);
+	unlockMutex(shared->writer);
+}
+
+bool sharedDelete(sharedTreeADT shared, elementT value){
+	size_t size;
+
+	lockMutex(shared->writer);
+	size=treeSize(shared->tree);
+	beginWrite(shared);
+	treeDelete(shared->tree,value);
+	endWrite(shared);
+	size-=treeSize(shared->tree);
+	unlockMutex(shared->writer);
+	return (size>0);
+}
+
+size_t sharedSize(sharedTreeADT shared){
+	size_t size;
+
+	lockMutex(shared->writer);
+	size=treeSize(shared->tree);
+	unlockMutex(shared->writer);
+	return (size);
+}
+
+sharedReaderADT newSharedReader(sharedTreeADT shared){
+	sharedReaderADT reader;
+
+	if(shared==NULL)
+		Error("Tree not initialized!");
+	reader=New(sharedReaderADT);
+	reader->slot=newEpochSlot(shared->epochs);
+	reader->shared=shared;
+	reader->values=NewArray(INITIAL_VALUES,elementT);
+	reader->capacity=INITIAL_VALUES;
+	reader->retries=0;
+	return (reader);
+}
+
+void freeSharedReader(sharedReaderADT reader){
+
+	if(reader==NULL)
+		Error("Reader not initialized!");
+	freeEpochSlot(reader->slot);
+	FreeBlock(reader->values);
+	FreeBlock(reader);
+}
+
+elementT sharedFind(sharedReaderADT reader, elementT value){
+	sharedTreeADT shared=reader->shared;
+	elementT result;
+#ifndef RB_INDEX_NODES
+	int32_t sequence;
+
+	enterEpoch(reader->slot);
+	for(;;){
+		sequence=beginRead(shared);
+		if(treeTryFind(shared->tree,value,&result) && endRead(shared,sequence))
+			break;
+		reader->retries++;
+	}
+	leaveEpoch(reader->slot);
+#else
+	lockMutex(shared->writer);
+	result=findNode(shared->tree,value);
+	unlockMutex(shared->writer);
+#endif
+	return (result);
+}
+
+/*
+ * Implementation notes: sharedRangeScan
+ * ---------------------------
+ * If the values don't fit, the buffer is made twice as big as
+ * the number seen and the scan is done again.
+ */
+void sharedRangeScan(sharedReaderADT reader, elementT lo, elementT hi,
+                     scanFnT fn, void *clientData){
+	sharedTreeADT shared=reader->shared;
+	size_t i,n;
+#ifndef RB_INDEX_NODES
+	int32_t sequence;
+
+	enterEpoch(reader->slot);
+	for(;;){
+		sequence=beginRead(shared);
+		if(!treeTryRange(shared->tree,lo,hi,reader->values,reader->capacity,&n) ||
+		   !endRead(shared,sequence))
+			reader->retries++;
+		else if(n>reader->capacity)
+			growValues(reader,n);
+		else
+			break;
+	}
+	leaveEpoch(reader->slot);
+#else
+	lockMutex(shared->writer);
+	while(treeTryRange(shared->tree,lo,hi,reader->values,reader->capacity,&n) &&
+	      n>reader->capacity)
+		growValues(reader,n);
+	unlockMutex(shared->writer);
+#endif
+	for(i=0;i<n;i++)
+		fn(reader->values[i],clientData);
+}
+
+size_t sharedRetries(sharedReaderADT reader){
+	return (reader->retries);
+}
+
+/**************** End of exported entries *******************/
+
+/*
+ * Functions: beginWrite, endWrite
+ * ---------------------------
+ * Make the sequence odd for the write and even again after it.
+ * atomicAdd is a full fence, so readers see the odd number
+ * before any change to the tree, and all changes before the
+ * even one.
+ */
+static void beginWrite(sharedTreeADT shared){
+	atomicAdd(&shared->sequence,1);
+}
+
+static void endWrite(sharedTreeADT shared){
+	atomicAdd(&shared->sequence,1);
+	reclaimNodes(shared);
+}
+
+/*
+ * Function: reclaimNodes
+ * ---------------------------
+ * Gives back the pending nodes if every reader is outside the
+ * tree or came in after they were retired, and starts a new
+ * epoch for the next batch of retired nodes. A reader that
+ * came in later can't reach them, since they were unlinked
+ * before the epoch changed.
+ */
+static void reclaimNodes(sharedTreeADT shared){
+
+	if(shared->pending){
+		if(oldestEpoch(shared->epochs)<shared->pendingEpoch)
+			return;
+		treeReclaim(shared->tree,shared->pendingMark);
+		shared->pending=FALSE;
+	}
+	if(treeRetired(shared->tree)>=RECLAIM_BATCH){
+		shared->pendingMark=treeRetired(shared->tree);
+		shared->pendingEpoch=advanceEpoch(shared->epochs);
+		shared->pending=TRUE;
+	}
+}
+
+static void growValues(sharedReaderADT reader, size_t n){
+
+	FreeBlock(reader->values);
+	reader->capacity=2*n;
+	reader->values=NewArray(reader->capacity,elementT);
+}
+
+#ifndef RB_INDEX_NODES
+/*
+ * Functions: beginRead, endRead
+ * ---------------------------
+ * beginRead waits until no write is in progress and returns
+ * the sequence number, endRead tells if it is unchanged. The
+ * fences keep the reads of the tree between the two reads of
+ * the sequence.
+ */
+static int32_t beginRead(sharedTreeADT shared){
+	int32_t sequence;
+
+	while((sequence=shared->sequence)&1)
+		yieldThread();
+	acquireFence();
+	return (sequence);
+}
+
+static bool endRead(sharedTreeADT shared, int32_t sequence){
+	acquireFence();
+	return (shared->sequence==sequence);
+}
+#endif
@@ -0,0 +1,136 @@
+/*
+ * File: sharedtree.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports a red-black tree that many threads can
+ * share. One writer at a time changes the tree in place, as
+ * redblack.h does, while readers search it without taking
+ * any lock. A reader notes the tree's sequence number before
+ * it searches and checks afterwards that no write has begun
+ * or ended in between, else it searches again. Reads scale
+ * with the number of cores since readers write nothing that
+ * other threads read, and a write delays readers only while
+ * it runs.
+ *
+ * Deleted nodes are not reused while a reader may still be
+ * looking at them: each reader publishes the epoch in which
+ * it started, and the writer gives retired nodes back once
+ * every reader has moved past the epoch they were retired in.
+ *
+ * Each reading thread needs a reader of its own.
+ *
+ * In index mode the node array moves when it grows, so there
+ * readers take the writer's lock instead.
+ */
+
+#ifndef _sharedtree_h
+#define _sharedtree_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Types: sharedTreeADT, sharedReaderADT
+ * --------------------------
+ * The type sharedTreeADT points to the shared tree's concrete
+ * type, and sharedReaderADT to the state of one reading thread.
+ */
+
+typedef struct sharedTreeCDT *sharedTreeADT;
+typedef struct sharedReaderCDT *sharedReaderADT;
+
+/*
+ * Function: newSharedTree
+ * Usage: shared = newSharedTree();
+ * --------------------------
+ * This function allocates and returns an empty shared tree.
+ */
+
+sharedTreeADT newSharedTree(void);
+
+/*
+ * Function: freeSharedTree
+ * Usage: freeSharedTree(shared);
+ * -------------------------------
+ * This procedure frees the storage associated with the tree.
+ * Its readers must be freed first.
+ */
+
+void freeSharedTree(sharedTreeADT shared);
+
+/*
+ * Functions: sharedInsert, sharedDelete
+ * Usage: sharedInsert(shared, value); if(sharedDelete(shared, value)) ...
+ * -------------------------------
+ * These insert or delete a value like treeInsert and treeDelete,
+ * from any thread. Writers take turns. sharedDelete returns
+ * FALSE if the value doesn't exist.
+ */
+
+void sharedInsert(sharedTreeADT shared, elementT value);
+bool sharedDelete(sharedTreeADT shared, elementT value);
+
+/*
+ * Function: sharedSize
+ * Usage: n=sharedSize(shared);
+ * -------------------------------
+ * This function returns the number of values in the tree.
+ */
+
+size_t sharedSize(sharedTreeADT shared);
+
+/*
+ * Function: newSharedReader
+ * Usage: reader = newSharedReader(shared);
+ * --------------------------
+ * This function registers a reader with the tree. A reader is
+ * used by one thread at a time.
+ */
+
+sharedReaderADT newSharedReader(sharedTreeADT shared);
+
+/*
+ * Function: freeSharedReader
+ * Usage: freeSharedReader(reader);
+ * -------------------------------
+ * This procedure unregisters the reader and frees it.
+ */
+
+void freeSharedReader(sharedReaderADT reader);
+
+/*
+ * Function: sharedFind
+ * Usage: value=sharedFind(reader, value);
+ * -------------------------------
+ * This function is findNode for a reader. It returns the
+ * value or NOT_FOUND as the tree was at some moment during
+ * the call.
+ */
+
+elementT sharedFind(sharedReaderADT reader, elementT value);
+
+/*
+ * Function: sharedRangeScan
+ * Usage: sharedRangeScan(reader, lo, hi, fn, &total);
+ * -------------------------------
+ * This procedure calls fn(value, clientData) for every value
+ * v with lo <= v < hi, in increasing order, as the tree was
+ * at some moment during the call. The values are copied out
+ * first, so fn may take as long as it likes.
+ */
+
+void sharedRangeScan(sharedReaderADT reader, elementT lo, elementT hi,
+                     scanFnT fn, void *clientData);
+
+/*
+ * Function: sharedRetries
+ * Usage: n=sharedRetries(reader);
+ * -------------------------------
+ * This function returns how many times the reader has had
+ * to search again because a write got in the way.
+ */
+
+size_t sharedRetries(sharedReaderADT reader);
+
+#endif
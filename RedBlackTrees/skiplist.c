@@ -0,0 +1,530 @@
+/*
+ * File: skiplist.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the skiplist.h interface, a lock-free
+ * skip list after Fraser and after Herlihy and Shavit, with
+ * epoch-based reclamation of the deleted nodes.
+ */
+
+#include <stddef.h>
+#include "skiplist.h"
+#include "platform.h"
+#include "epoch.h"
+#include "genlib.h"
+
+/*
+ * Constants
+ * ---------------------------
+ * MAX_LEVEL       -- Number of levels, a node is on level i
+ *                    with probability 4^-i, enough for 4^12
+ *                    values
+ * RECLAIM_BATCH   -- Nodes a handle retires between attempts
+ *                    to start a new epoch
+ * INITIAL_LIMBO   -- Nodes a limbo list starts with room for
+ */
+#define MAX_LEVEL 12
+#define RECLAIM_BATCH 128
+#define INITIAL_LIMBO 64
+
+/*
+ * Type: nodeT
+ * ---------------------------
+ * A node is linked into the levels 0 to levels-1. The lowest
+ * bit of a link is set when the node is being deleted, after
+ * which the link never changes. A node is deleted once its
+ * link on level 0 is marked. owners counts the inserting and
+ * the deleting thread as they are done with the node; the last
+ * one retires it.
+ */
+typedef struct nodeT {
+	elementT key;
+	int levels;
+	volatile int32_t owners;
+	struct nodeT *volatile next[1];
+} *nodeT;
+
+#define isMarked(link) (((uintptr_t)(link))&1)
+#define marked(link) ((nodeT)((uintptr_t)(link)|1))
+#define unmarked(link) ((nodeT)((uintptr_t)(link)&~(uintptr_t)1))
+#define swapLink(link,old,new) atomicCompareSwapPointer((void *volatile *)(link),(old),(new))
+
+/*
+ * limbo[i] holds the nodes the handle retired in epoch
+ * limboEpoch[i], i = epoch % 3.
+ */
+struct skipHandleCDT {
+	epochSlotADT slot;
+	skipListADT list;
+	unsigned seed;
+	nodeT *limbo[3];
+	size_t limboCount[3],limboCapacity[3];
+	int32_t limboEpoch[3];
+	size_t retired;
+};
+
+/*
+ * orphans holds the retired nodes of freed handles and is
+ * only used under lock.
+ */
+struct skipListCDT {
+	nodeT head;
+	epochADT epochs;
+	mutexADT lock;
+	nodeT *orphans;
+	size_t orphanCount,orphanCapacity;
+};
+
+/* Private Function Prototypes */
+static nodeT newNode(elementT value, int levels);
+static int randomLevel(skipHandleADT handle);
+static bool findPath(skipListADT list, elementT value, nodeT preds[], nodeT succs[]);
+static bool tryFindPath(skipListADT list, elementT value, nodeT preds[], nodeT succs[]);
+static void unlinkNode(skipListADT list, nodeT node);
+static bool tryUnlinkNode(skipListADT list, nodeT node);
+static void linkLevels(skipListADT list, nodeT node, nodeT preds[], nodeT succs[]);
+static bool linkLevel(skipListADT list, nodeT node, int i, nodeT preds[], nodeT succs[]);
+static bool markNode(nodeT node);
+static void releaseNode(skipHandleADT handle, nodeT node);
+static void retireNode(skipHandleADT handle, nodeT node);
+static void appendNode(nodeT **nodes, size_t *count, size_t *capacity, nodeT node);
+static void freeNodes(nodeT nodes[], size_t n);
+
+/******************* Exported entries **********************/
+
+skipListADT newSkipList(void){
+	skipListADT list;
+	int i;
+
+	list=New(skipListADT);
+	list->head=newNode(0,MAX_LEVEL);
+	for(i=0;i<MAX_LEVEL;i++)
+		list->head->next[i]=NULL;
+	list->epochs=newEpoch();
+	list->lock=newMutex();
+	list->orphans=NULL;
+	list->orphanCount=list->orphanCapacity=0;
+	return (list);
+}
+
+void freeSkipList(skipListADT list){
+	nodeT node,next;
+
+	if(list==NULL)
+		Error("List not initialized!");
+	freeEpoch(list->epochs);
+	for(node=list->head;node!=NULL;node=next){
+		next=unmarked(node->next[0]);
+		FreeBlock(node);
+	}
+	freeNodes(list->orphans,list->orphanCount);
+	if(list->orphans!=NULL)
+		free(list->orphans);
+	freeMutex(list->lock);
+	FreeBlock(list);
+}
+
+skipHandleADT newSkipHandle(skipListADT list){
+	skipHandleADT handle;
+	int i;
+
+	if(list==NULL)
+		Error("List not initialized!");
+	handle=New(skipHandleADT);
+	handle->slot=newEpochSlot(list->epochs);
+	handle->list=list;
+	handle->seed=(unsigned)(size_t)handle;
+	for(i=0;i<3;i++){
+		handle->limbo[i]=NULL;
+		handle->limboCount[i]=handle->limboCapacity[i]=0;
+		handle->limboEpoch[i]=0;
+	}
+	handle->retired=0;
+	return (handle);
+}
+
+/*
+ * Implementation notes: freeSkipHandle
+ * ---------------------------
+ * Other threads may still be reading the nodes in the handle's
+ * limbo lists, so they are kept until the list is freed.
+ */
+void freeSkipHandle(skipHandleADT handle){
+	skipListADT list;
+	size_t j;
+	int i;
+
+	if(handle==NULL)
+		Error("Handle not initialized!");
+	list=handle->list;
+	freeEpochSlot(handle->slot);
+	lockMutex(list->lock);
+	for(i=0;i<3;i++){
+		for(j=0;j<handle->limboCount[i];j++)
+			appendNode(&list->orphans,&list->orphanCount,&list->orphanCapacity,handle->limbo[i][j]);
+		if(handle->limbo[i]!=NULL)
+			free(handle->limbo[i]);
+	}
+	unlockMutex(list->lock);
+	FreeBlock(handle);
+}
+
+/*
+ * Implementation notes: skipInsert
+ * ---------------------------
+ * The node is in the list once it is linked on level 0, the
+ * other levels only make it faster to find.
+ */
+bool skipInsert(skipHandleADT handle, elementT value){
+	skipListADT list=handle->list;
+	nodeT preds[MAX_LEVEL],succs[MAX_LEVEL];
+	nodeT node=NULL;
+	int i;
+
+	enterEpoch(handle->slot);
+	for(;;){
+		if(findPath(list,value,preds,succs)){
+			leaveEpoch(handle->slot);
+			if(node!=NULL)
+				FreeBlock(node);
+			return (FALSE);
+		}
+		if(node==NULL)
+			node=newNode(value,randomLevel(handle));
+		for(i=0;i<node->levels;i++)
+			node->next[i]=succs[i];
+		if(swapLink(&preds[0]->next[0],succs[0],node))
+			break;
+	}
+	linkLevels(list,node,preds,succs);
+	releaseNode(handle,node);
+	leaveEpoch(handle->slot);
+	return (TRUE);
+}
+
+bool skipDelete(skipHandleADT handle, elementT value){
+	skipListADT list=handle->list;
+	nodeT preds[MAX_LEVEL],succs[MAX_LEVEL];
+	nodeT node;
+	bool deleted=FALSE;
+
+	enterEpoch(handle->slot);
+	if(findPath(list,value,preds,succs) && markNode(node=succs[0])){
+		unlinkNode(list,node);
+		releaseNode(handle,node);
+		deleted=TRUE;
+	}
+	leaveEpoch(handle->slot);
+	return (deleted);
+}
+
+/*
+ * Implementation notes: skipFind
+ * ---------------------------
+ * The search steps over marked nodes without unlinking them,
+ * so it never writes and never starts over.
+ */
+elementT skipFind(skipHandleADT handle, elementT value){
+	nodeT pred,curr=NULL,succ;
+	elementT result=NOT_FOUND;
+	int level;
+
+	enterEpoch(handle->slot);
+	pred=handle->list->head;
+	for(level=MAX_LEVEL-1;level>=0;level--){
+		curr=unmarked(pred->next[level]);
+		while(curr!=NULL){
+			succ=curr->next[level];
+			if(isMarked(succ))
+				curr=unmarked(succ);
+			else if(curr->key < value){
+				pred=curr;
+				curr=succ;
+			} else
+				break;
+		}
+	}
+	if(curr!=NULL && !(value < curr->key))
+		result=curr->key;
+	leaveEpoch(handle->slot);
+	return (result);
+}
+
+elementT skipDeleteMin(skipHandleADT handle){
+	skipListADT list=handle->list;
+	nodeT node;
+	elementT value=NOT_FOUND;
+
+	enterEpoch(handle->slot);
+	for(node=unmarked(list->head->next[0]);node!=NULL;node=unmarked(node->next[0]))
+		if(markNode(node)){
+			value=node->key;
+			unlinkNode(list,node);
+			releaseNode(handle,node);
+			break;
+		}
+	leaveEpoch(handle->slot);
+	return (value);
+}
+
+size_t skipSize(skipHandleADT handle){
+	nodeT node;
+	size_t n=0;
+
+	enterEpoch(handle->slot);
+	for(node=unmarked(handle->list->head->next[0]);node!=NULL;node=unmarked(node->next[0]))
+		if(!isMarked(node->next[0]))
+			n++;
+	leaveEpoch(handle->slot);
+	return (n);
+}
+
+/**************** End of exported entries *******************/
+
+static nodeT newNode(elementT value, int levels){
+	nodeT node;
+
+	node=GetBlock(offsetof(struct nodeT,next)+levels*sizeof(nodeT));
+	node->key=value;
+	node->levels=levels;
+	node->owners=0;
+	return (node);
+}
+
+/*
+ * Function: randomLevel
+ * ---------------------------
+ * Draws the number of levels from two bits at a time of the
+ * high bits of the seed. The bit above them ends the draw at
+ * MAX_LEVEL.
+ */
+static int randomLevel(skipHandleADT handle){
+	unsigned bits;
+	int levels=1;
+
+	handle->seed=handle->seed*1103515245+12345;
+	bits=(handle->seed>>10)|(1u<<(2*MAX_LEVEL-2));
+	while((bits&3)==0){
+		levels++;
+		bits>>=2;
+	}
+	return (levels);
+}
+
+/*
+ * Function: findPath
+ * ---------------------------
+ * Sets preds[i] to the last node on level i before value and
+ * succs[i] to the node after it, and returns TRUE if succs[0]
+ * holds value. Marked nodes on the way are unlinked, so none
+ * is left among preds and succs.
+ */
+static bool findPath(skipListADT list, elementT value, nodeT preds[], nodeT succs[]){
+
+	while(!tryFindPath(list,value,preds,succs))
+		;
+	return (succs[0]!=NULL && !(value < succs[0]->key));
+}
+
+/*
+ * Function: tryFindPath
+ * ---------------------------
+ * Does the search of findPath, but gives up and returns FALSE
+ * when a marked node can't be unlinked because the link to it
+ * has changed.
+ */
+static bool tryFindPath(skipListADT list, elementT value, nodeT preds[], nodeT succs[]){
+	nodeT pred,curr,succ;
+	int level;
+
+	pred=list->head;
+	for(level=MAX_LEVEL-1;level>=0;level--){
+		curr=unmarked(pred->next[level]);
+		while(curr!=NULL){
+			succ=curr->next[level];
+			if(isMarked(succ)){
+				if(!swapLink(&pred->next[level],curr,unmarked(succ)))
+					return (FALSE);
+				curr=unmarked(succ);
+			} else if(curr->key < value){
+				pred=curr;
+				curr=succ;
+			} else
+				break;
+		}
+		preds[level]=pred;
+		succs[level]=curr;
+	}
+	return (TRUE);
+}
+
+/*
+ * Function: unlinkNode
+ * ---------------------------
+ * Unlinks the marked node from every level before it is
+ * retired. findPath is not enough: it stops at the first node
+ * not less than the key, and an insert of the same key may
+ * have linked its node in front of this one on some level.
+ * So this search walks on over equal keys, unlinking every
+ * marked node it meets.
+ */
+static void unlinkNode(skipListADT list, nodeT node){
+
+	while(!tryUnlinkNode(list,node))
+		;
+}
+
+/*
+ * Function: tryUnlinkNode
+ * ---------------------------
+ * Does the search of unlinkNode and gives up like tryFindPath.
+ * pred is the last node on the level before the key and prev
+ * the node the walk came from. It also gives up if pred is
+ * being deleted, since nodes linked after pred was unlinked
+ * can't be reached from it.
+ */
+static bool tryUnlinkNode(skipListADT list, nodeT node){
+	nodeT pred,prev,curr,succ;
+	int level;
+
+	pred=list->head;
+	for(level=MAX_LEVEL-1;level>=0;level--){
+		prev=pred;
+		curr=pred->next[level];
+		if(isMarked(curr))
+			return (FALSE);
+		while(curr!=NULL && !(node->key < curr->key)){
+			succ=curr->next[level];
+			if(isMarked(succ)){
+				if(!swapLink(&prev->next[level],curr,unmarked(succ)))
+					return (FALSE);
+				curr=unmarked(succ);
+			} else {
+				if(curr->key < node->key)
+					pred=curr;
+				prev=curr;
+				curr=succ;
+			}
+		}
+	}
+	return (TRUE);
+}
+
+/*
+ * Function: linkLevels
+ * ---------------------------
+ * Links the node on its upper levels and stops if the node is
+ * being deleted. If a deleting thread marked it after it was
+ * linked somewhere, it may have searched before that link was
+ * made, so the node is unlinked here once more.
+ */
+static void linkLevels(skipListADT list, nodeT node, nodeT preds[], nodeT succs[]){
+	int i;
+
+	for(i=1;i<node->levels && linkLevel(list,node,i,preds,succs);i++)
+		;
+	if(isMarked(node->next[0]))
+		unlinkNode(list,node);
+}
+
+/*
+ * Function: linkLevel
+ * ---------------------------
+ * Links the node on level i between preds[i] and succs[i],
+ * searching again whenever a link has changed, and returns
+ * FALSE if the node is being deleted instead.
+ */
+static bool linkLevel(skipListADT list, nodeT node, int i, nodeT preds[], nodeT succs[]){
+	nodeT succ;
+
+	for(;;){
+		succ=node->next[i];
+		if(isMarked(succ))
+			return (FALSE);
+		if(succ!=succs[i] && !swapLink(&node->next[i],succ,succs[i]))
+			continue;
+		if(swapLink(&preds[i]->next[i],succs[i],node))
+			return (TRUE);
+		findPath(list,node->key,preds,succs);
+	}
+}
+
+/*
+ * Function: markNode
+ * ---------------------------
+ * Marks the links of the node from the top down and returns
+ * TRUE if this thread marked level 0, and so deleted it.
+ */
+static bool markNode(nodeT node){
+	nodeT succ;
+	int i;
+
+	for(i=node->levels-1;i>0;i--){
+		succ=node->next[i];
+		while(!isMarked(succ) && !swapLink(&node->next[i],succ,marked(succ)))
+			succ=node->next[i];
+	}
+	for(;;){
+		succ=node->next[0];
+		if(isMarked(succ))
+			return (FALSE);
+		if(swapLink(&node->next[0],succ,marked(succ)))
+			return (TRUE);
+	}
+}
+
+static void releaseNode(skipHandleADT handle, nodeT node){
+	if(atomicAdd(&node->owners,1)==2)
+		retireNode(handle,node);
+}
+
+/*
+ * Function: retireNode
+ * ---------------------------
+ * Puts an unlinked node in the limbo list of the current epoch.
+ * A thread that could still reach the node came in before it
+ * was unlinked, in this epoch or the one before, and so has
+ * left once the list is two epochs further on. The epoch is
+ * read after the node was unlinked, not taken from the handle,
+ * since the handle's may lag behind. A limbo list is emptied
+ * before it is reused for a new epoch, and every batch of
+ * retired nodes tries to start a new epoch.
+ */
+static void retireNode(skipHandleADT handle, nodeT node){
+	int32_t epoch=currentEpoch(handle->list->epochs);
+	int i=epoch%3;
+
+	if(handle->limboEpoch[i]!=epoch){
+		freeNodes(handle->limbo[i],handle->limboCount[i]);
+		handle->limboCount[i]=0;
+		handle->limboEpoch[i]=epoch;
+	}
+	appendNode(&handle->limbo[i],&handle->limboCount[i],&handle->limboCapacity[i],node);
+	if(++handle->retired<RECLAIM_BATCH)
+		return;
+	handle->retired=0;
+	tryAdvanceEpoch(handle->list->epochs);
+	epoch=currentEpoch(handle->list->epochs);
+	for(i=0;i<3;i++)
+		if(handle->limboCount[i]>0 && handle->limboEpoch[i]+2<=epoch){
+			freeNodes(handle->limbo[i],handle->limboCount[i]);
+			handle->limboCount[i]=0;
+		}
+}
+
+static void appendNode(nodeT **nodes, size_t *count, size_t *capacity, nodeT node){
+	if(*count==*capacity){
+		*capacity=(*capacity==0) ? INITIAL_LIMBO : 2**capacity;
+		*nodes=realloc(*nodes,*capacity*sizeof(nodeT));
+		if(*nodes==NULL)
+			Error("No memory available");
+	}
+	(*nodes)[(*count)++]=node;
+}
+
+static void freeNodes(nodeT nodes[], size_t n){
+	size_t i;
+
+	for(i=0;i<n;i++)
+		FreeBlock(nodes[i]);
+}
@@ -0,0 +1,121 @@
+/*
+ * File: skiplist.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports a lock-free ordered set, a skip list that
+ * any number of threads can insert into, delete from and search
+ * at the same time without taking a lock. A thread that is
+ * stopped in the middle of an operation never holds up the
+ * others, so there are no convoys behind a lock holder that
+ * lost its processor.
+ *
+ * A value is deleted by marking the links out of its node, and
+ * any thread that comes by unlinks a marked node. Unlinked nodes
+ * are freed once every thread has left the epoch in which they
+ * were unlinked, so a thread never reads freed memory.
+ *
+ * Each thread uses the list through a handle of its own.
+ *
+ * Unlike redblack.h the list is a set: a value can only be in
+ * it once.
+ */
+
+#ifndef _skiplist_h
+#define _skiplist_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Types: skipListADT, skipHandleADT
+ * --------------------------
+ * The type skipListADT points to the skip list's concrete type,
+ * and skipHandleADT to the state of one thread using it.
+ */
+
+typedef struct skipListCDT *skipListADT;
+typedef struct skipHandleCDT *skipHandleADT;
+
+/*
+ * Function: newSkipList
+ * Usage: list = newSkipList();
+ * --------------------------
+ * This function allocates and returns an empty skip list.
+ */
+
+skipListADT newSkipList(void);
+
+/*
+ * Function: freeSkipList
+ * Usage: freeSkipList(list);
+ * -------------------------------
+ * This procedure frees the storage associated with the list.
+ * Its handles must be freed first.
+ */
+
+void freeSkipList(skipListADT list);
+
+/*
+ * Function: newSkipHandle
+ * Usage: handle = newSkipHandle(list);
+ * --------------------------
+ * This function registers a thread with the list. A handle is
+ * used by one thread at a time.
+ */
+
+skipHandleADT newSkipHandle(skipListADT list);
+
+/*
+ * Function: freeSkipHandle
+ * Usage: freeSkipHandle(handle);
+ * -------------------------------
+ * This procedure unregisters the handle and frees it.
+ */
+
+void freeSkipHandle(skipHandleADT handle);
+
+/*
+ * Functions: skipInsert, skipDelete
+ * Usage: if(skipInsert(handle, value)) ...
+ * -------------------------------
+ * These insert or delete a value like treeInsert and treeDelete.
+ * skipInsert returns FALSE if the value already exists and
+ * skipDelete if it doesn't.
+ */
+
+bool skipInsert(skipHandleADT handle, elementT value);
+bool skipDelete(skipHandleADT handle, elementT value);
+
+/*
+ * Function: skipFind
+ * Usage: value=skipFind(handle, value);
+ * -------------------------------
+ * This function is findNode for the skip list. It returns the
+ * value or NOT_FOUND.
+ */
+
+elementT skipFind(skipHandleADT handle, elementT value);
+
+/*
+ * Function: skipDeleteMin
+ * Usage: value=skipDeleteMin(handle);
+ * -------------------------------
+ * This function deletes the smallest value and returns it, or
+ * NOT_FOUND if the list is empty. Threads calling it at the
+ * same time get different values.
+ */
+
+elementT skipDeleteMin(skipHandleADT handle);
+
+/*
+ * Function: skipSize
+ * Usage: n=skipSize(handle);
+ * -------------------------------
+ * This function counts the values in the list, in O(n). It is
+ * only exact while no other thread changes the list.
+ */
+
+size_t skipSize(skipHandleADT handle);
+
+#endif
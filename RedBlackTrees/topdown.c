@@ -0,0 +1,310 @@
+/*
+ * File: topdown.c
+ * Author: Kristoffer Johansson
+ * --------------
+ * This file implements the topdown.h interface. Insert and
+ * delete follow the single-pass scheme of Guibas and
+ * Sedgewick: on the way down, insert splits every node with
+ * two red children and delete makes sure the next node is
+ * red, so the change at the bottom never has to travel up.
+ */
+
+#include <stdio.h>
+#include "topdown.h"
+#include "arena.h"
+#include "genlib.h"
+
+/*
+ * Type: nodeT
+ * ---------------------------
+ * The children are indexed by direction, 0 is left and 1 is
+ * right, so every case is written once for both directions.
+ * The color fits in the padding after the key and a missing
+ * child is NULL.
+ */
+typedef struct nodeT {
+	elementT key;
+	bool red;
+	struct nodeT *child[2];
+} *nodeT;
+
+#define isRed(n) ((n)!=NULL && (n)->red)
+
+struct tdTreeCDT {
+	nodeT root;
+	size_t size;
+	arenaADT arena;
+};
+
+/* Private Function Prototypes */
+static nodeT newNode(tdTreeADT tree, elementT value);
+static nodeT rotate(nodeT x, int dir);
+static nodeT rotateTwice(nodeT x, int dir);
+static int checkSubtree(nodeT x);
+static int recTreeHeight(nodeT x);
+
+/******************* Exported entries **********************/
+
+tdTreeADT newTdTree(void){
+	tdTreeADT tree;
+
+	tree=New(tdTreeADT);
+	tree->root=NULL;
+	tree->size=0;
+	tree->arena=newArena(sizeof(struct nodeT));
+	return (tree);
+}
+
+void freeTdTree(tdTreeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	freeArena(tree->arena);
+	FreeBlock(tree);
+}
+
+elementT tdFind(tdTreeADT tree, elementT value){
+	nodeT x;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	x=tree->root;
+	while(x!=NULL){
+		if(value < x->key)
+			x=x->child[0];
+		else if(value > x->key)
+			x=x->child[1];
+		else /* (value == x->key) */
+			return (x->key);
+	}
+	return (NOT_FOUND);
+}
+
+/*
+ * Implementation notes: tdInsert
+ * ---------------------------
+ * q walks down from the root with its parent p, grandparent
+ * g and great-grandparent t in tow. A black q with two red
+ * children is flipped, and if that makes q and p both red,
+ * g is rotated, which is why t is needed. The new node is
+ * added red at the bottom and fixed up by the same test.
+ * A fake node above the root lets rotations at the root
+ * work like any other.
+ */
+void tdInsert(tdTreeADT tree, elementT value){
+	struct nodeT head;
+	nodeT t,g,p,q,z;
+	int dir=0,last=0,side;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	head.red=FALSE;
+	head.child[0]=NULL;
+	head.child[1]=tree->root;
+	t=&head;
+	g=p=NULL;
+	q=tree->root;
+	z=NULL;
+	for(;;){
+		if(q==NULL){
+			q=z=newNode(tree,value);
+			if(p==NULL)
+				head.child[1]=q;
+			else
+				p->child[dir]=q;
+		}else if(isRed(q->child[0]) && isRed(q->child[1])){
+			q->red=TRUE;
+			q->child[0]->red=FALSE;
+			q->child[1]->red=FALSE;
+		}
+		if(isRed(q) && isRed(p)){
+			side=(t->child[1]==g);
+			if(q==p->child[last])
+				t->child[side]=rotate(g,!last);
+			else
+				t->child[side]=rotateTwice(g,!last);
+		}
+		if(q==z)
+			break;
+		last=dir;
+		dir=!(value < q->key);
+		if(g!=NULL)
+			t=g;
+		g=p;
+		p=q;
+		q=q->child[dir];
+	}
+	tree->root=head.child[1];
+	tree->root->red=FALSE;
+	tree->size++;
+}
+
+/*
+ * Implementation notes: tdDelete
+ * ---------------------------
+ * The walk goes left on an equal key and right on a smaller
+ * one, so it ends at the in-order predecessor of the last
+ * match, or at the match itself. Before stepping down, a
+ * black q whose next child is black is made red: by a
+ * rotation if its other child is red, else by a color flip
+ * with its sibling s, or by rotating p when s has a red
+ * child. The bottom node is then red or has a red child,
+ * and its key is moved into the match before it is removed.
+ */
+bool tdDelete(tdTreeADT tree, elementT value){
+	struct nodeT head;
+	nodeT g,p,q,s,f,top;
+	int dir,last,side;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->root==NULL)
+		return (FALSE);
+	head.red=FALSE;
+	head.child[0]=NULL;
+	head.child[1]=tree->root;
+	q=&head;
+	g=p=f=NULL;
+	dir=1;
+	while(q->child[dir]!=NULL){
+		last=dir;
+		g=p;
+		p=q;
+		q=q->child[dir];
+		dir=(q->key < value);
+		if(!dir && !(value < q->key))
+			f=q;
+		if(!isRed(q) && !isRed(q->child[dir])){
+			if(isRed(q->child[!dir])){
+				p=p->child[last]=rotate(q,dir);
+			}else if((s=p->child[!last])!=NULL){
+				if(!isRed(s->child[0]) && !isRed(s->child[1])){
+					p->red=FALSE;
+					s->red=TRUE;
+					q->red=TRUE;
+				}else{
+					side=(g->child[1]==p);
+					if(isRed(s->child[last]))
+						top=g->child[side]=rotateTwice(p,last);
+					else
+						top=g->child[side]=rotate(p,last);
+					q->red=top->red=TRUE;
+					top->child[0]->red=FALSE;
+					top->child[1]->red=FALSE;
+				}
+			}
+		}
+	}
+	if(f!=NULL){
+		f->key=q->key;
+		p->child[p->child[1]==q]=q->child[q->child[0]==NULL];
+		arenaFree(tree->arena,q);
+		tree->size--;
+	}
+	tree->root=head.child[1];
+	if(tree->root!=NULL)
+		tree->root->red=FALSE;
+	return (f!=NULL);
+}
+
+size_t tdSize(tdTreeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (tree->size);
+}
+
+int tdHeight(tdTreeADT tree){
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	return (recTreeHeight(tree->root));
+}
+
+int tdBlackHeight(tdTreeADT tree){
+	int bHeight;
+
+	if(tree==NULL)
+		Error("Tree not initialized!");
+	if(tree->root==NULL) return 0;
+	if(tree->root->red) return -1;
+	bHeight=checkSubtree(tree->root);
+	return (bHeight<0 ? -1 : bHeight-1);
+}
+
+size_t tdMemoryUsage(tdTreeADT tree){
+	return (sizeof(struct tdTreeCDT)+arenaBytes(tree->arena));
+}
+
+/**************** End of exported entries *******************/
+
+static nodeT newNode(tdTreeADT tree, elementT value){
+	nodeT node;
+
+	node=arenaAlloc(tree->arena);
+	node->key=value;
+	node->red=TRUE;
+	node->child[0]=node->child[1]=NULL;
+	return (node);
+}
+
+/*
+ * Function: rotate
+ * ---------------------------
+ * Rotates x in the given direction, 0 for left and 1 for
+ * right, and returns the child that took its place. The
+ * new top becomes black and x red.
+ */
+static nodeT rotate(nodeT x, int dir){
+	nodeT y=x->child[!dir];
+
+	x->child[!dir]=y->child[dir];
+	y->child[dir]=x;
+	x->red=TRUE;
+	y->red=FALSE;
+	return (y);
+}
+
+/*
+ * Function: rotateTwice
+ * ---------------------------
+ * The double rotation: first the child of x away from dir
+ * the other way, then x itself.
+ */
+static nodeT rotateTwice(nodeT x, int dir){
+
+	x->child[!dir]=rotate(x->child[!dir],!dir);
+	return (rotate(x,dir));
+}
+
+/*
+ * Function: checkSubtree
+ * ---------------------------
+ * Returns the number of black nodes on every path from x
+ * down to a leaf, x included, or -1 if the paths differ,
+ * a red node has a red child or the keys are out of order.
+ */
+static int checkSubtree(nodeT x){
+	int lh,rh;
+
+	if(x==NULL) return 0;
+	if(x->red && (isRed(x->child[0]) || isRed(x->child[1])))
+		return (-1);
+	if((x->child[0]!=NULL && x->key < x->child[0]->key) ||
+	   (x->child[1]!=NULL && x->child[1]->key < x->key))
+		return (-1);
+	lh=checkSubtree(x->child[0]);
+	rh=checkSubtree(x->child[1]);
+	if(lh<0 || lh!=rh)
+		return (-1);
+	return (lh+!x->red);
+}
+
+static int recTreeHeight(nodeT x){
+	int lh,rh;
+
+	if(x==NULL) return 0;
+	lh=recTreeHeight(x->child[0]);
+	rh=recTreeHeight(x->child[1]);
+	return (1+(lh>rh ? lh : rh));
+}
@@ -0,0 +1,122 @@
+/*
+ * File: topdown.h
+ * Author: Kristoffer Johansson
+ * --------------------------------
+ * This file exports a second red-black tree engine, which
+ * rebalances top-down on the way from the root to a leaf
+ * instead of walking back up after the change, the way a
+ * 2-3-4 tree splits full nodes before entering them. Every
+ * insert and delete is therefore one single pass and the
+ * nodes need no parent pointer, which makes them 8 bytes
+ * smaller than those of redblack.h.
+ *
+ * Without parents there are no cursors, so this engine only
+ * offers the basic operations. It takes the same values as
+ * redblack.h, duplicates included.
+ */
+
+#ifndef _topdown_h
+#define _topdown_h
+
+#include <stdlib.h>
+#include "genlib.h"
+#include "redblack.h"
+
+/*
+ * Type: tdTreeADT
+ * --------------------------
+ * The type tdTreeADT points to the top-down tree's concrete type.
+ */
+
+typedef struct tdTreeCDT *tdTreeADT;
+
+/*
+ * Function: newTdTree
+ * Usage: tree = newTdTree();
+ * --------------------------
+ * This function allocates and returns an empty tree.
+ */
+
+tdTreeADT newTdTree(void);
+
+/*
+ * Function: freeTdTree
+ * Usage: freeTdTree(tree);
+ * -------------------------------
+ * This procedure frees the storage associated with the tree.
+ */
+
+void freeTdTree(tdTreeADT tree);
+
+/*
+ * Function: tdFind
+ * Usage: value=tdFind(tree, value);
+ * -------------------------------
+ * This function is used to find a value in the tree.
+ * If the value doesn't exist the function returns the
+ * constant NOT_FOUND.
+ */
+
+elementT tdFind(tdTreeADT tree, elementT value);
+
+/*
+ * Function: tdInsert
+ * Usage: tdInsert(tree, value);
+ * -------------------------------
+ * This procedure inserts a value into the tree. Equal
+ * values are kept, after those already there.
+ */
+
+void tdInsert(tdTreeADT tree, elementT value);
+
+/*
+ * Function: tdDelete
+ * Usage: if(tdDelete(tree, value)) ...
+ * -------------------------------
+ * This function deletes one occurrence of the value and
+ * returns TRUE, or returns FALSE if the value doesn't exist.
+ * The tree is rebalanced on the way down in either case.
+ */
+
+bool tdDelete(tdTreeADT tree, elementT value);
+
+/*
+ * Function: tdSize
+ * Usage: n=tdSize(tree);
+ * -------------------------------
+ * This function returns the number of values in the tree.
+ */
+
+size_t tdSize(tdTreeADT tree);
+
+/*
+ * Function: tdHeight
+ * Usage: height=tdHeight(tree);
+ * -------------------------------
+ * This function returns the height of the tree.
+ */
+
+int tdHeight(tdTreeADT tree);
+
+/*
+ * Function: tdBlackHeight
+ * Usage: bHeight=tdBlackHeight(tree);
+ * -------------------------------
+ * This function checks the red-black properties of the
+ * whole tree and returns its black height, counted like
+ * blackHeight does, or -1 if a property is broken.
+ */
+
+int tdBlackHeight(tdTreeADT tree);
+
+/*
+ * Function: tdMemoryUsage
+ * Usage: bytes=tdMemoryUsage(tree);
+ * -------------------------------
+ * This function returns the number of bytes held by the tree,
+ * including unused space in its node storage.
+ */
+
+size_t tdMemoryUsage(tdTreeADT tree);
+
+#endif